@@ -0,0 +1,674 @@
+// Session server: the HTTP API in http.h on a loopback port, for web front
+// ends that would otherwise run one terminal per player. Each turn is
+// microseconds of engine work, so a loop is bound by syscalls, and
+// pipelined requests that arrive together are answered with one write.
+//
+// The server is sharded: one epoll loop per core, pinned to it, each with
+// its own SO_REUSEPORT listener, sessions, idle sweep and counters, so the
+// request path shares nothing between cores. The kernel spreads new
+// connections over the listeners; a connection that names a session on
+// another shard is handed over once through that shard's mailbox.
+//
+// Loops run on epoll by default. --backend=uring runs them on io_uring
+// instead, which submits a loop iteration's sends and receives with its
+// wait for completions, one system call for all of them.
+//
+// While a loop has nothing ready it starts games ahead of demand, up to
+// --warm-sessions per shard, so a burst of new players each get one that
+// is already at its intro prompt.
+//
+//     ./station_server [--port=N] [--shards=N] [--idle-minutes=N] [--warm-sessions=N] [--backend=epoll|uring]
+#include <csignal>
+#include <mutex>
+#include <thread>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include "http.h"
+#include "uring.h"
+
+static atomic<bool> stopRequested{false};
+
+static void requestStop(int) {
+    stopRequested = true;
+}
+
+// A non-blocking listener on 127.0.0.1 that other shards' listeners share;
+// -1 on failure
+static int listenLoopback(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// One shard: a listener, the sessions created through it and the loop that
+// serves its connections, on epoll or io_uring
+class Shard {
+    public:
+        static constexpr chrono::seconds CONNECTION_IDLE{60};  // Keep-alive connections with nothing to do
+
+        Shard(int listener, int shard, int shardCount, ShardMetrics* allMetrics, chrono::seconds idleTimeout,
+              size_t warmSessions, StationDirectory* stations, const vector<unique_ptr<Shard>>& shards)
+            : listener(listener), api(idleTimeout, warmSessions, shard, shardCount, allMetrics, stations),
+              metrics(allMetrics[shard]),
+              shards(shards) {
+            wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        }
+
+        virtual ~Shard() {
+            for (auto& connection : inbox) ::close(connection->fd);
+            ::close(wakeup);
+            ::close(listener);
+        }
+
+        // Serve until stopRequested
+        virtual void run() = 0;
+
+        // Take over a connection from another shard; called on that
+        // shard's thread, the only cross-shard path
+        void adopt(unique_ptr<HttpConnection> connection) {
+            {
+                lock_guard<mutex> lock(inboxMutex);
+                inbox.push_back(move(connection));
+            }
+            uint64_t one = 1;
+            if (write(wakeup, &one, sizeof(one)) < 0) {
+                // The counter is already nonzero, so a wakeup is pending
+            }
+        }
+
+    protected:
+        int listener;
+        int wakeup;  // eventfd: connections are waiting in the inbox
+        SessionApi api;
+        ShardMetrics& metrics;
+
+        // Connections handed over since the last call, ready to serve here
+        vector<unique_ptr<HttpConnection>> takeInbox() {
+            vector<unique_ptr<HttpConnection>> arrived;
+            {
+                lock_guard<mutex> lock(inboxMutex);
+                arrived.swap(inbox);
+            }
+            for (auto& connection : arrived) {
+                connection->handoffTo = -1;
+                ShardMetrics::add(metrics.connections);
+                ShardMetrics::add(metrics.handoffsIn);
+            }
+            return arrived;
+        }
+
+        // Pass a connection to the shard its next request is for
+        void handOff(unique_ptr<HttpConnection> connection) {
+            ShardMetrics::add(metrics.connections, -1);
+            ShardMetrics::add(metrics.handoffsOut);
+            int target = connection->handoffTo;
+            shards[target]->adopt(move(connection));
+        }
+
+    private:
+        const vector<unique_ptr<Shard>>& shards;
+        mutex inboxMutex;
+        vector<unique_ptr<HttpConnection>> inbox;
+};
+
+// Level-triggered epoll: a read or write call per ready connection
+class EpollServer : public Shard {
+    public:
+        static const int MAX_EVENTS = 256;
+
+        EpollServer(int listener, int shard, int shardCount, ShardMetrics* allMetrics, chrono::seconds idleTimeout,
+                    size_t warmSessions, StationDirectory* stations, const vector<unique_ptr<Shard>>& shards)
+            : Shard(listener, shard, shardCount, allMetrics, idleTimeout, warmSessions, stations, shards) {
+            epoll = epoll_create1(EPOLL_CLOEXEC);
+            for (int fd : {listener, wakeup}) {
+                epoll_event event = {};
+                event.events = EPOLLIN;
+                event.data.fd = fd;
+                epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+            }
+        }
+
+        ~EpollServer() {
+            for (auto& entry : clients) ::close(entry.first);
+            ::close(epoll);
+        }
+
+        void run() override {
+            epoll_event events[MAX_EVENTS];
+            auto lastSweep = chrono::steady_clock::now();
+            while (!stopRequested) {
+                int ready = epoll_wait(epoll, events, MAX_EVENTS, api.wantsWarming() ? 0 : 1000);
+                if (ready < 0 && errno != EINTR) {
+                    perror("epoll_wait");
+                    return;
+                }
+                for (int i = 0; i < ready; i++) {
+                    if (events[i].data.fd == listener) {
+                        acceptAll();
+                        continue;
+                    }
+                    if (events[i].data.fd == wakeup) {
+                        takeHandoffs();
+                        continue;
+                    }
+                    auto found = clients.find(events[i].data.fd);
+                    if (found == clients.end()) continue;
+                    HttpConnection& connection = *found->second.connection;
+                    if (events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN)) {
+                        drop(connection.fd);
+                        continue;
+                    }
+                    if (events[i].events & EPOLLIN) readAll(connection);
+                    if (events[i].events & EPOLLOUT) writeOut(connection);
+                    settle(connection);
+                }
+                if (ready == 0) api.warmUp(SessionApi::WARM_BATCH);  // Nothing else to do
+                auto now = chrono::steady_clock::now();
+                if (now - lastSweep >= chrono::seconds(1)) {
+                    lastSweep = now;
+                    sweep(now);
+                }
+            }
+        }
+
+    private:
+        struct Client {
+            unique_ptr<HttpConnection> connection;
+            uint32_t interest;  // Events registered with epoll
+        };
+
+        int epoll;
+        unordered_map<int, Client> clients;
+
+        void acceptAll() {
+            while (true) {
+                int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    if (errno == EINTR) continue;
+                    return;  // EAGAIN, or out of descriptors until some close
+                }
+                int on = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+                ShardMetrics::add(metrics.connections);
+                ShardMetrics::add(metrics.connectionsAccepted);
+                watch(unique_ptr<HttpConnection>(new HttpConnection(fd)));
+            }
+        }
+
+        HttpConnection& watch(unique_ptr<HttpConnection> connection) {
+            int fd = connection->fd;
+            Client& client = clients[fd];
+            client.connection = move(connection);
+            client.interest = EPOLLIN;
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+            return *client.connection;
+        }
+
+        void takeHandoffs() {
+            uint64_t count;
+            if (read(wakeup, &count, sizeof(count)) < 0) return;
+            for (auto& arrived : takeInbox()) {
+                HttpConnection& connection = watch(move(arrived));
+                connection.serve(api);  // The request it was handed over for
+                settle(connection);
+            }
+        }
+
+        // Read what has arrived, answering requests as they complete
+        void readAll(HttpConnection& connection) {
+            while (connection.wantsInput()) {
+                size_t available;
+                char* space = connection.readSpace(available);
+                ssize_t count = read(connection.fd, space, available);
+                if (count > 0) {
+                    connection.received(count);
+                    connection.serve(api);
+                } else if (count == 0) {
+                    connection.inputEnded = true;
+                    return;
+                } else if (errno != EINTR) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) connection.closing = true;
+                    return;
+                }
+            }
+        }
+
+        void writeOut(HttpConnection& connection) {
+            connection.out.flush();
+            if (connection.out.pendingBytes() == 0 && connection.hasBuffered()) {
+                connection.serve(api);  // Requests held back while output was backed up
+            }
+        }
+
+        // Pass the connection to the shard it asked for, or carry on here
+        void settle(HttpConnection& connection) {
+            // Answers that go out at once make room for requests held back
+            connection.out.flush();
+            while (connection.handoffTo < 0 && connection.out.pendingBytes() == 0 && connection.hasBuffered() &&
+                   connection.serve(api)) {
+                connection.out.flush();
+            }
+            if (connection.handoffTo < 0) {
+                update(connection);
+                return;
+            }
+            int fd = connection.fd;
+            epoll_ctl(epoll, EPOLL_CTL_DEL, fd, NULL);
+            auto found = clients.find(fd);
+            unique_ptr<HttpConnection> leaving = move(found->second.connection);
+            clients.erase(found);
+            handOff(move(leaving));
+        }
+
+        // Send what is pending, then close or register for what comes next
+        void update(HttpConnection& connection) {
+            Client& client = clients[connection.fd];
+            if (connection.inputEnded && !connection.out.overHighWater()) {
+                connection.closing = true;  // Every complete request has been answered
+            }
+            connection.out.flush();
+            bool pending = connection.out.pendingBytes() > 0;
+            if (connection.out.isStalled() || (connection.closing && !pending)) {
+                drop(connection.fd);
+                return;
+            }
+            uint32_t interest = (connection.wantsInput() && !connection.inputEnded ? EPOLLIN : 0) | (pending ? EPOLLOUT : 0);
+            if (interest != client.interest) {
+                epoll_event event = {};
+                event.events = interest;
+                event.data.fd = connection.fd;
+                epoll_ctl(epoll, EPOLL_CTL_MOD, connection.fd, &event);
+                client.interest = interest;
+            }
+        }
+
+        void drop(int fd) {
+            epoll_ctl(epoll, EPOLL_CTL_DEL, fd, NULL);
+            ::close(fd);
+            clients.erase(fd);
+            ShardMetrics::add(metrics.connections, -1);
+        }
+
+        void sweep(chrono::steady_clock::time_point now) {
+            api.expire(now);
+            vector<int> idle;
+            for (auto& entry : clients) {
+                HttpConnection& connection = *entry.second.connection;
+                if (now - connection.lastActive > CONNECTION_IDLE && connection.out.pendingBytes() == 0) {
+                    idle.push_back(entry.first);
+                }
+            }
+            for (int fd : idle) drop(fd);
+        }
+};
+
+// io_uring: one multishot accept, receives into a ring of provided buffers
+// and each connection's pending answers as one gathered sendmsg. Every
+// operation the loop queues goes in with the wait for completions, so an
+// iteration is one system call however many connections it serves.
+class UringServer : public Shard {
+    public:
+        static const unsigned RING_ENTRIES = 4096;
+        static const unsigned BUFFER_COUNT = 256;
+        static const unsigned BUFFER_SIZE = HttpConnection::READ_CHUNK / 2;  // Always fits readSpace()
+        static const uint16_t BUFFER_GROUP = 0;
+
+        UringServer(int listener, int shard, int shardCount, ShardMetrics* allMetrics, chrono::seconds idleTimeout,
+                    size_t warmSessions, StationDirectory* stations, const vector<unique_ptr<Shard>>& shards)
+            : Shard(listener, shard, shardCount, allMetrics, idleTimeout, warmSessions, stations, shards),
+              ring(RING_ENTRIES) {
+            setupError = ring.error();
+            if (setupError == 0) {
+                setupError = -ring.provideBuffers(BUFFER_COUNT, BUFFER_SIZE, BUFFER_GROUP);
+            }
+        }
+
+        ~UringServer() {
+            for (auto& entry : clients) ::close(entry.second.connection->fd);
+        }
+
+        // 0, or the errno that kept the ring from being set up
+        int error() const {
+            return setupError;
+        }
+
+        void run() override {
+            armAccept();
+            armWakeup();
+            auto lastSweep = chrono::steady_clock::now();
+            while (!stopRequested) {
+                int result = ring.submitAndWait(api.wantsWarming() ? 0 : 1000);
+                if (result < 0 && result != -ETIME && result != -EINTR && result != -EBUSY) {
+                    fprintf(stderr, "io_uring_enter: %s\n", strerror(-result));
+                    return;
+                }
+                bool idle = true;
+                ring.completions([this, &idle](const io_uring_cqe& cqe) {
+                    idle = false;
+                    complete(cqe);
+                });
+                if (idle) api.warmUp(SessionApi::WARM_BATCH);  // Nothing else to do
+                auto now = chrono::steady_clock::now();
+                if (now - lastSweep >= chrono::seconds(1)) {
+                    lastSweep = now;
+                    sweep(now);
+                }
+            }
+        }
+
+    private:
+        enum Operation : uint64_t { ACCEPT = 1, RECEIVE, SEND, WAKEUP, CANCEL };
+        static const uint64_t ID_MASK = (1ULL << 56) - 1;
+
+        // A connection and the operations it has in flight. It is freed, or
+        // handed over, only once none are.
+        struct Client {
+            unique_ptr<HttpConnection> connection;
+            uint64_t id;
+            bool receiving = false;
+            bool sending = false;
+            bool cancelling = false;  // The receive is being cancelled for a hand-off
+            bool dropping = false;    // Shut down; closed once nothing is in flight
+            chrono::steady_clock::time_point sendStarted;
+            msghdr message;           // The sendmsg in flight
+        };
+
+        unordered_map<uint64_t, Client> clients;  // By ID: descriptors are reused while completions are in flight
+        IoUring ring;                             // Declared after clients so pending sends end first
+        int setupError;
+        uint64_t nextId = 1;
+        uint64_t wakeupCount;
+        bool accepting = false;
+
+        static uint64_t tag(Operation operation, uint64_t id) {
+            return (uint64_t)operation << 56 | id;
+        }
+
+        void armAccept() {
+            io_uring_sqe* sqe = ring.next();
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->fd = listener;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = SOCK_CLOEXEC;
+            sqe->user_data = tag(ACCEPT, 0);
+            accepting = true;
+        }
+
+        void armWakeup() {
+            io_uring_sqe* sqe = ring.next();
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = wakeup;
+            sqe->addr = (uint64_t)&wakeupCount;
+            sqe->len = sizeof(wakeupCount);
+            sqe->user_data = tag(WAKEUP, 0);
+        }
+
+        void receive(Client& client) {
+            io_uring_sqe* sqe = ring.next();
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = client.connection->fd;
+            sqe->len = BUFFER_SIZE;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = BUFFER_GROUP;
+            sqe->user_data = tag(RECEIVE, client.id);
+            client.receiving = true;
+        }
+
+        void send(Client& client) {
+            const auto& text = client.connection->out.pendingText();
+            client.message = {};
+            client.message.msg_iov = const_cast<iovec*>(text.data());
+            client.message.msg_iovlen = text.size();
+            io_uring_sqe* sqe = ring.next();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = client.connection->fd;
+            sqe->addr = (uint64_t)&client.message;
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL;
+            sqe->user_data = tag(SEND, client.id);
+            client.sending = true;
+            client.sendStarted = chrono::steady_clock::now();
+        }
+
+        void cancelReceive(Client& client) {
+            io_uring_sqe* sqe = ring.next();
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = tag(RECEIVE, client.id);
+            sqe->user_data = tag(CANCEL, client.id);
+            client.cancelling = true;
+        }
+
+        Client& track(unique_ptr<HttpConnection> connection) {
+            uint64_t id = nextId++ & ID_MASK;
+            Client& client = clients[id];
+            client.connection = move(connection);
+            client.id = id;
+            return client;
+        }
+
+        void complete(const io_uring_cqe& cqe) {
+            uint64_t id = cqe.user_data & ID_MASK;
+            switch (cqe.user_data >> 56) {
+                case ACCEPT:
+                    if (cqe.res >= 0) accepted(cqe.res);
+                    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                        accepting = false;
+                        if (cqe.res >= 0) armAccept();  // Otherwise retried by the sweep
+                    }
+                    break;
+                case WAKEUP:
+                    for (auto& arrived : takeInbox()) {
+                        settle(track(move(arrived)));
+                    }
+                    armWakeup();
+                    break;
+                case RECEIVE:
+                    received(id, cqe);
+                    break;
+                case SEND:
+                    sent(id, cqe);
+                    break;
+            }
+        }
+
+        void accepted(int fd) {
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            ShardMetrics::add(metrics.connections);
+            ShardMetrics::add(metrics.connectionsAccepted);
+            settle(track(unique_ptr<HttpConnection>(new HttpConnection(fd))));
+        }
+
+        void received(uint64_t id, const io_uring_cqe& cqe) {
+            Client& client = clients.find(id)->second;
+            client.receiving = false;
+            HttpConnection& connection = *client.connection;
+            if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                uint16_t bufferId = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+                const char* data = ring.buffer(bufferId);
+                for (size_t done = 0; !client.dropping && done < (size_t)cqe.res;) {
+                    size_t available;
+                    char* space = connection.readSpace(available);
+                    size_t count = min(available, (size_t)cqe.res - done);
+                    memcpy(space, data + done, count);
+                    connection.received(count);
+                    done += count;
+                }
+                ring.recycle(bufferId);
+            } else if (cqe.res == 0) {
+                connection.inputEnded = true;
+            } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+                startDrop(client);  // Reset, or the like
+            }
+            settle(client);
+        }
+
+        void sent(uint64_t id, const io_uring_cqe& cqe) {
+            Client& client = clients.find(id)->second;
+            client.sending = false;
+            if (cqe.res >= 0) {
+                client.connection->out.sent(cqe.res);
+            } else {
+                startDrop(client);
+            }
+            settle(client);
+        }
+
+        // Answer what is buffered once the last answer is out, then queue
+        // the next send and receive, hand the connection over, or close it
+        void settle(Client& client) {
+            HttpConnection& connection = *client.connection;
+            if (!client.dropping) {
+                if (!client.sending && connection.out.pendingBytes() == 0) {
+                    if (connection.hasBuffered() && connection.handoffTo < 0) connection.serve(api);
+                    if (connection.out.pendingBytes() == 0 && connection.handoffTo < 0 &&
+                        (connection.closing || connection.inputEnded)) {
+                        startDrop(client);  // Every complete request has been answered
+                    }
+                }
+            }
+            if (!client.dropping) {
+                if (!client.sending && connection.out.pendingBytes() > 0) send(client);
+                if (connection.handoffTo >= 0) {
+                    if (client.receiving && !client.cancelling) cancelReceive(client);
+                    if (!client.receiving && !client.sending) {
+                        unique_ptr<HttpConnection> leaving = move(client.connection);
+                        uint64_t id = client.id;
+                        clients.erase(id);
+                        handOff(move(leaving));
+                    }
+                } else if (!client.receiving && !connection.inputEnded && connection.wantsInput()) {
+                    receive(client);
+                }
+                return;
+            }
+            if (!client.receiving && !client.sending) {
+                ::close(connection.fd);
+                uint64_t id = client.id;
+                clients.erase(id);
+                ShardMetrics::add(metrics.connections, -1);
+            }
+        }
+
+        // Close once the operations in flight finish; shutting the socket
+        // down makes them finish now
+        void startDrop(Client& client) {
+            client.dropping = true;
+            if (client.receiving || client.sending) shutdown(client.connection->fd, SHUT_RDWR);
+        }
+
+        void sweep(chrono::steady_clock::time_point now) {
+            api.expire(now);
+            if (!accepting) armAccept();
+            vector<uint64_t> idle;
+            for (auto& entry : clients) {
+                Client& client = entry.second;
+                bool stuck = client.sending && now - client.sendStarted > CONNECTION_IDLE;
+                if (!client.dropping && now - client.connection->lastActive > CONNECTION_IDLE &&
+                    (!client.sending || stuck)) {
+                    idle.push_back(entry.first);
+                }
+            }
+            for (uint64_t id : idle) {
+                Client& client = clients.find(id)->second;
+                startDrop(client);
+                settle(client);
+            }
+        }
+};
+
+int main(int argc, char** argv) {
+    int port = 8080;
+    int idleMinutes = 30;
+    int warmSessions = 64;
+    int shardCount = max(1u, thread::hardware_concurrency());
+    bool uring = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--port=", 0) == 0) port = atoi(arg.c_str() + 7);
+        else if (arg.rfind("--shards=", 0) == 0) shardCount = atoi(arg.c_str() + 9);
+        else if (arg.rfind("--idle-minutes=", 0) == 0) idleMinutes = atoi(arg.c_str() + 15);
+        else if (arg.rfind("--warm-sessions=", 0) == 0) warmSessions = max(0, atoi(arg.c_str() + 16));
+        else if (arg == "--backend=epoll") uring = false;
+        else if (arg == "--backend=uring") uring = true;
+        else {
+            fprintf(stderr, "usage: %s [--port=N] [--shards=N] [--idle-minutes=N] [--warm-sessions=N] [--backend=epoll|uring]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (shardCount < 1 || shardCount > HTTP_MAX_SHARDS) {
+        fprintf(stderr, "--shards must be 1 to %d\n", HTTP_MAX_SHARDS);
+        return 2;
+    }
+
+    vector<ShardMetrics> metrics(shardCount);
+    StationDirectory stations;
+    vector<unique_ptr<Shard>> shards;
+    for (int i = 0; i < shardCount; i++) {
+        int listener = listenLoopback(port);
+        if (listener < 0) {
+            perror("listen");
+            return 1;
+        }
+        chrono::seconds idleTimeout = chrono::minutes(idleMinutes);
+        if (!uring) {
+            shards.emplace_back(
+                new EpollServer(listener, i, shardCount, metrics.data(), idleTimeout, warmSessions, &stations, shards));
+            continue;
+        }
+        UringServer* server =
+            new UringServer(listener, i, shardCount, metrics.data(), idleTimeout, warmSessions, &stations, shards);
+        shards.emplace_back(server);
+        if (server->error()) {
+            fprintf(stderr, "io_uring: %s (needs Linux 5.19 or later); try --backend=epoll\n", strerror(server->error()));
+            return 1;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN);  // A client gone mid-write shows up as EPIPE
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+    fprintf(stderr, "Listening on http://127.0.0.1:%d with %d %s shards\n", port, shardCount, uring ? "io_uring" : "epoll");
+
+    vector<thread> threads;
+    int cores = max(1u, thread::hardware_concurrency());
+    for (int i = 0; i < shardCount; i++) {
+        threads.emplace_back([&shards, i] { shards[i]->run(); });
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(i % cores, &cpus);
+        pthread_setaffinity_np(threads.back().native_handle(), sizeof(cpus), &cpus);
+    }
+    for (thread& t : threads) t.join();
+    shards.clear();
+
+    for (int i = 0; i < shardCount; i++) {
+        const ShardMetrics& m = metrics[i];
+        fprintf(stderr, "Shard %d: %zu requests, %zu sessions created, %zu open; %zu connections, %zu handed in, %zu out\n",
+                i, ShardMetrics::read(m.requests), ShardMetrics::read(m.sessionsCreated), ShardMetrics::read(m.sessions),
+                ShardMetrics::read(m.connectionsAccepted), ShardMetrics::read(m.handoffsIn),
+                ShardMetrics::read(m.handoffsOut));
+    }
+    return 0;
+}
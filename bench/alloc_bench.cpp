@@ -0,0 +1,140 @@
+// Allocation counter for the command hot path. Plays a scripted loop of
+// everyday commands (search, take, drop, inventory, map, help, ...) and
+// reports how many heap allocations the measured turns made, counting
+// blocks taken from the session slab (slab.h) as well as operator new. Once
+// the game is warmed up a steady-state turn should allocate nothing.
+//
+// Build and run with: make bench
+#include <cstdlib>
+#include <new>
+
+static size_t allocationCount = 0;
+static size_t allocationBytes = 0;
+
+// Every replaceable form, so each allocation is counted and each pointer
+// goes back to the allocator it came from. Not inlined: GCC would then see
+// free() on the result of operator new and warn.
+__attribute__((noinline)) static void* counted(size_t size) {
+    allocationCount++;
+    allocationBytes += size;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+__attribute__((noinline)) static void release(void* p) noexcept {
+    free(p);
+}
+
+void* operator new(size_t size) {
+    return counted(size);
+}
+
+void* operator new[](size_t size) {
+    return counted(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return counted(size);
+    } catch (...) {
+        return NULL;
+    }
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return counted(size);
+    } catch (...) {
+        return NULL;
+    }
+}
+
+void operator delete(void* p) noexcept {
+    release(p);
+}
+
+void operator delete[](void* p) noexcept {
+    release(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    release(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    release(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    release(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    release(p);
+}
+
+#include "../game.h"
+
+// One lap of the steady-state loop; prompt answers follow their command
+static const char* const LAP[] = {
+    "search",
+    "take crowbar",
+    "I",
+    "d", "2",
+    "i",
+    "m",
+    "h",
+    "examine headlight",
+    "take the duct tape",
+    "g", "1",
+    "u", "0",
+    "look",
+    "xyzzy",
+    "use radio",
+    "e", "0",
+};
+
+int main() {
+    const int WARMUP_LAPS = 3;
+    const int MEASURED_LAPS = 1000;
+
+    // Script: dismiss the intro, turn on the light, then run the laps
+    vector<string> script = { "", "use headlight" };
+    for (int lap = 0; lap < WARMUP_LAPS + MEASURED_LAPS; lap++) {
+        for (const char* line : LAP) script.push_back(line);
+    }
+    size_t warmupEnd = 2 + WARMUP_LAPS * (sizeof(LAP) / sizeof(LAP[0]));
+
+    // The game's frame has no descriptor, so its output is dropped on flush;
+    // only the report reaches stdout
+    Game game;
+    size_t measuredTurns = 0;
+    size_t countAtStart = 0;
+    size_t bytesAtStart = 0;
+    size_t slabAtStart = 0;
+
+    // Prompt answers are lines of their own, handed to whichever question
+    // the previous line left open
+    for (size_t line = 0; line < script.size(); line++) {
+        if (line == warmupEnd) {
+            countAtStart = allocationCount;
+            bytesAtStart = allocationBytes;
+            slabAtStart = Slab::allocations();
+        }
+        game.parseCommand(script[line]);
+        game.out << "\n> ";
+        game.out.flush();
+        if (line >= warmupEnd) measuredTurns++;
+    }
+    size_t allocations = allocationCount - countAtStart;
+    size_t bytes = allocationBytes - bytesAtStart;
+    size_t slabBlocks = Slab::allocations() - slabAtStart;
+
+    game.out.flush();
+    printf("turns measured: %zu\n", measuredTurns);
+    printf("allocations:    %zu (%zu bytes)\n", allocations, bytes);
+    printf("slab blocks:    %zu\n", slabBlocks);
+    printf("per turn:       %.3f\n", measuredTurns ? (double)(allocations + slabBlocks) / measuredTurns : 0.0);
+    return allocations == 0 && slabBlocks == 0 ? 0 : 1;
+}
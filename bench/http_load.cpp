@@ -0,0 +1,215 @@
+// Load generator for station_server: each connection starts a session,
+// then sends everyday commands in pipelined batches and waits for every
+// answer before the next batch. Prints requests per second and the latency
+// of a batch round trip. With --starts, each connection first starts and
+// deletes that many sessions one at a time and the time to the intro is
+// reported too.
+//
+// Usage: ./http_load [--port=N] [--connections=N] [--requests=N] [--depth=N] [--starts=N]
+//        requests and starts are per connection; depth is how many are pipelined
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Commands that keep the game going however often they are repeated
+static const char* const COMMANDS[] = { "search", "i", "h", "xyzzy", "examine headlight", "map" };
+
+struct Options {
+    int port = 8080;
+    int connections = 8;
+    long requests = 10000;
+    int depth = 8;
+    int starts = 0;
+};
+
+struct Result {
+    long requests = 0;
+    vector<double> batchMicros;
+    vector<double> startMicros;  // POST /sessions to its answer
+    bool failed = false;
+};
+
+class Client {
+    public:
+        explicit Client(int port) {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            ok = connect(fd, (sockaddr*)&address, sizeof(address)) == 0;
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+
+        ~Client() {
+            close(fd);
+        }
+
+        bool ok;
+
+        void add(const char* method, const string& path, const string& body) {
+            out += method;
+            out += " " + path + " HTTP/1.1\r\nHost: localhost\r\nContent-Length: " + to_string(body.size()) + "\r\n\r\n" + body;
+        }
+
+        bool send() {
+            for (size_t done = 0; done < out.size();) {
+                ssize_t count = write(fd, out.data() + done, out.size() - done);
+                if (count <= 0) return false;
+                done += count;
+            }
+            out.clear();
+            return true;
+        }
+
+        // The next response's status and body
+        bool receive(int& status, string& body) {
+            size_t headEnd;
+            while ((headEnd = in.find("\r\n\r\n")) == string::npos) {
+                if (!fill()) return false;
+            }
+            status = atoi(in.c_str() + 9);
+            size_t length = 0;
+            size_t header = in.find("Content-Length: ");
+            if (header != string::npos && header < headEnd) length = atol(in.c_str() + header + 16);
+            while (in.size() < headEnd + 4 + length) {
+                if (!fill()) return false;
+            }
+            body = in.substr(headEnd + 4, length);
+            in.erase(0, headEnd + 4 + length);
+            return true;
+        }
+
+    private:
+        int fd;
+        string out;
+        string in;
+
+        bool fill() {
+            char chunk[65536];
+            ssize_t count = read(fd, chunk, sizeof(chunk));
+            if (count <= 0) return false;
+            in.append(chunk, count);
+            return true;
+        }
+};
+
+static void runConnection(const Options& options, Result& result) {
+    Client client(options.port);
+    int status;
+    string body;
+    for (int i = 0; i < options.starts && client.ok; i++) {
+        auto start = chrono::steady_clock::now();
+        client.add("POST", "/sessions", "");
+        if (!client.send() || !client.receive(status, body) || status != 201) {
+            result.failed = true;
+            return;
+        }
+        result.startMicros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        client.add("DELETE", "/sessions/" + body.substr(body.find("\"id\":\"") + 6, 16), "");
+        if (!client.send() || !client.receive(status, body) || status != 204) {
+            result.failed = true;
+            return;
+        }
+    }
+    client.add("POST", "/sessions", "");
+    if (!client.ok || !client.send() || !client.receive(status, body) || status != 201) {
+        result.failed = true;
+        return;
+    }
+    size_t idStart = body.find("\"id\":\"") + 6;
+    string commands = "/sessions/" + body.substr(idStart, 16) + "/commands";
+    client.add("POST", commands, "");  // Past the intro
+    if (!client.send() || !client.receive(status, body)) {
+        result.failed = true;
+        return;
+    }
+
+    size_t next = 0;
+    while (result.requests < options.requests) {
+        int batch = (int)min<long>(options.depth, options.requests - result.requests);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < batch; i++) {
+            client.add("POST", commands, COMMANDS[next++ % (sizeof(COMMANDS) / sizeof(COMMANDS[0]))]);
+        }
+        if (!client.send()) {
+            result.failed = true;
+            return;
+        }
+        for (int i = 0; i < batch; i++) {
+            if (!client.receive(status, body) || status != 200) {
+                result.failed = true;
+                return;
+            }
+        }
+        result.batchMicros.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        result.requests += batch;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--port=", 0) == 0) options.port = atoi(arg.c_str() + 7);
+        else if (arg.rfind("--connections=", 0) == 0) options.connections = atoi(arg.c_str() + 14);
+        else if (arg.rfind("--requests=", 0) == 0) options.requests = atol(arg.c_str() + 11);
+        else if (arg.rfind("--depth=", 0) == 0) options.depth = max(1, atoi(arg.c_str() + 8));
+        else if (arg.rfind("--starts=", 0) == 0) options.starts = max(0, atoi(arg.c_str() + 9));
+        else {
+            fprintf(stderr, "usage: %s [--port=N] [--connections=N] [--requests=N] [--depth=N] [--starts=N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    vector<Result> results(options.connections);
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < options.connections; i++) {
+        threads.emplace_back(runConnection, cref(options), ref(results[i]));
+    }
+    for (thread& t : threads) t.join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    long total = 0;
+    int failed = 0;
+    vector<double> latencies;
+    vector<double> starts;
+    for (Result& result : results) {
+        total += result.requests;
+        failed += result.failed;
+        latencies.insert(latencies.end(), result.batchMicros.begin(), result.batchMicros.end());
+        starts.insert(starts.end(), result.startMicros.begin(), result.startMicros.end());
+    }
+    sort(latencies.begin(), latencies.end());
+    sort(starts.begin(), starts.end());
+    auto percentileOf = [](const vector<double>& sorted, double p) {
+        return sorted.empty() ? 0.0 : sorted[(size_t)(p * (sorted.size() - 1))];
+    };
+    auto percentile = [&](double p) { return percentileOf(latencies, p); };
+    if (!starts.empty()) {
+        printf("session start: %zu, p50 %.1f us, p99 %.1f us, max %.1f us\n", starts.size(), percentileOf(starts, 0.5),
+               percentileOf(starts, 0.99), percentileOf(starts, 1.0));
+    }
+    printf("connections %d, depth %d: %ld requests in %.3f s, %.0f requests/s\n", options.connections, options.depth,
+           total, seconds, total / seconds);
+    printf("batch round trip: p50 %.1f us, p99 %.1f us, max %.1f us\n", percentile(0.5), percentile(0.99),
+           percentile(1.0));
+    if (failed) {
+        printf("%d connections failed\n", failed);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,350 @@
+// Micro-benchmarks for the engine's hot functions: wrapText, the
+// parseCommand dispatch for each alias class, search() on rooms of
+// different sizes, takeItem name resolution, listInventory and showMap, and
+// the cost of a turn with and without display text, and the hint command.
+//
+// Each benchmark is calibrated so one sample takes about 20ms, then run for
+// a number of repetitions. Results are printed as JSON in the same layout
+// Google Benchmark uses (mean/median/stddev/cv aggregates per benchmark), so
+// two runs can be compared with its tools/compare.py:
+//
+//     make microbench
+//     ./microbench > before.json
+//     ... change something, rebuild ...
+//     ./microbench > after.json
+//     compare.py benchmarks before.json after.json
+//
+// Options: --filter=<substring>  --repetitions=<n>  --min-time-ms=<n>
+//
+// Output produced by the game is built into the frame as usual but cleared
+// after each operation instead of being written, so the numbers measure
+// formatting work and not the cost of the write syscall.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fcntl.h>
+#include <functional>
+
+#include "../game.h"
+
+struct Benchmark {
+    string name;
+    function<void()> setup;  // Runs before every sample, outside the timing
+    function<void()> body;   // The operation being measured
+};
+
+struct Sample {
+    string name;
+    long long iterations;
+    vector<double> nsPerOp;
+};
+
+static double percentile(vector<double> values, double fraction) {
+    sort(values.begin(), values.end());
+    double position = fraction * (values.size() - 1);
+    size_t lower = (size_t)position;
+    size_t upper = min(lower + 1, values.size() - 1);
+    return values[lower] + (values[upper] - values[lower]) * (position - lower);
+}
+
+static double mean(const vector<double>& values) {
+    double total = 0;
+    for (double v : values) total += v;
+    return total / values.size();
+}
+
+static double stddev(const vector<double>& values) {
+    if (values.size() < 2) return 0;
+    double m = mean(values);
+    double total = 0;
+    for (double v : values) total += (v - m) * (v - m);
+    return sqrt(total / (values.size() - 1));
+}
+
+static double elapsedNs(const function<void()>& body, long long iterations) {
+    auto start = chrono::steady_clock::now();
+    for (long long i = 0; i < iterations; i++) body();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(end - start).count();
+}
+
+static Sample run(const Benchmark& benchmark, int repetitions, double minTimeNs) {
+    // Calibrate: grow the iteration count until one sample is long enough
+    long long iterations = 1;
+    while (true) {
+        benchmark.setup();
+        double ns = elapsedNs(benchmark.body, iterations);
+        if (ns >= minTimeNs || iterations >= (1LL << 30)) break;
+        double scale = ns > 0 ? minTimeNs / ns * 1.4 : 10;
+        iterations = max(iterations + 1, (long long)(iterations * min(scale, 10.0)));
+    }
+
+    Sample sample;
+    sample.name = benchmark.name;
+    sample.iterations = iterations;
+    for (int r = 0; r < repetitions; r++) {
+        benchmark.setup();
+        sample.nsPerOp.push_back(elapsedNs(benchmark.body, iterations) / iterations);
+    }
+    return sample;
+}
+
+static void printAggregate(FILE* report, const Sample& sample, const char* aggregate, double value, bool last) {
+    fprintf(report,
+            "    {\n"
+            "      \"name\": \"%s_%s\",\n"
+            "      \"run_name\": \"%s\",\n"
+            "      \"run_type\": \"aggregate\",\n"
+            "      \"repetitions\": %zu,\n"
+            "      \"aggregate_name\": \"%s\",\n"
+            "      \"iterations\": %lld,\n"
+            "      \"real_time\": %.3f,\n"
+            "      \"cpu_time\": %.3f,\n"
+            "      \"time_unit\": \"ns\"\n"
+            "    }%s\n",
+            sample.name.c_str(), aggregate, sample.name.c_str(), sample.nsPerOp.size(),
+            aggregate, sample.iterations, value, value, last ? "" : ",");
+}
+
+// A paragraph of the given number of words, built from game text
+template <size_t N>
+static string paragraph(int words, const char* const (&vocabulary)[N]) {
+    string text;
+    for (int i = 0; i < words; i++) {
+        if (i) text += ' ';
+        text += vocabulary[i % N];
+    }
+    return text;
+}
+
+static const char* const ASCII_WORDS[] = {
+    "The", "maintenance", "corridor", "stretches", "before", "you,", "a",
+    "claustrophobic", "tunnel", "of", "exposed", "infrastructure."
+};
+
+// Multi-byte text: the degree sign, accents, box drawing and wide CJK
+static const char* const UTF8_WORDS[] = {
+    "Temperature:", "21°C", "café", "╔══════╗", "宇宙ステーション", "の",
+    "生命維持", "システム", "naïve", "한국어", "façade", "です。"
+};
+
+// Fill the current room with the given number of items: Radios, then an
+// Energy Bar last so taking it by name scans the whole room
+static void stockRoom(Game& game, int count) {
+    RoomItems& items = game.rooms[game.currentRoom].items;
+    items.clear();
+    for (int i = 1; i < count; i++) {
+        items.push_back(Item(ItemId::Radio));
+    }
+    items.push_back(Item(ItemId::EnergyBar));
+}
+
+// Give the player the given number of items (the Headlight stays first)
+static void stockInventory(Game& game, int count) {
+    game.inventory.erase(game.inventory.begin() + 1, game.inventory.end());
+    for (int i = 1; i < count; i++) {
+        game.inventory.push_back(Item((ItemId)(i - 1)));
+    }
+}
+
+int main(int argc, char** argv) {
+    string filter;
+    int repetitions = 10;
+    double minTimeNs = 20e6;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--filter=", 0) == 0) filter = arg.substr(9);
+        else if (arg.rfind("--repetitions=", 0) == 0) repetitions = max(2, atoi(arg.c_str() + 14));
+        else if (arg.rfind("--min-time-ms=", 0) == 0) minTimeNs = atof(arg.c_str() + 14) * 1e6;
+        else {
+            fprintf(stderr, "usage: %s [--filter=name] [--repetitions=n] [--min-time-ms=n]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // The report keeps the real stdout; the game writes to /dev/null
+    FILE* report = fdopen(dup(STDOUT_FILENO), "w");
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+
+    EngineConfig config;
+    config.showIntro = false;
+    Game game(1, config);
+    game.hasLight = true;
+    game.currentRoom = 2;  // Observation Deck: lit, no counters running
+    game.roomSearched[2] = true;
+    game.out.clear();
+
+    vector<Benchmark> benchmarks;
+    auto nothing = [] {};
+
+    // wrapText across paragraph lengths, for static and copied text, and
+    // for text that needs the UTF-8 decoder
+    static string paragraphs[5];
+    static string utf8Paragraphs[5];
+    const int WORD_COUNTS[] = { 8, 32, 128, 512, 2048 };
+    for (int i = 0; i < 5; i++) {
+        paragraphs[i] = paragraph(WORD_COUNTS[i], ASCII_WORDS);
+        utf8Paragraphs[i] = paragraph(WORD_COUNTS[i], UTF8_WORDS);
+        const char* text = paragraphs[i].c_str();
+        string words = to_string(WORD_COUNTS[i]);
+        benchmarks.push_back({"wrapText/static/" + words, nothing, [&game, text] {
+            game.wrapText(text, true);
+            game.out.clear();
+        }});
+        benchmarks.push_back({"wrapText/copied/" + words, nothing, [&game, i] {
+            game.wrapText(string_view(paragraphs[i]), false, "info");
+            game.out.clear();
+        }});
+        benchmarks.push_back({"wrapText/utf8/" + words, nothing, [&game, i] {
+            game.wrapText(utf8Paragraphs[i].c_str(), true);
+            game.out.clear();
+        }});
+    }
+
+    // parseCommand dispatch, one representative input per alias class.
+    // None of these prompt for input or change the game state.
+    struct Alias {
+        const char* name;
+        const char* input;
+    };
+    static const Alias ALIASES[] = {
+        { "search", "search room" },
+        { "take", "take the flux capacitor" },
+        { "examine", "examine the headlight" },
+        { "map", "show map" },
+        { "help", "show commands" },
+        { "inventory", "I" },
+        { "info", "room info" },
+        { "feel", "feel around" },
+        { "use", "use the flux capacitor" },
+        { "drop", "drop the flux capacitor" },
+        { "redirect", "look" },
+        { "unknown", "dance wildly" },
+    };
+    for (const Alias& alias : ALIASES) {
+        string_view input = alias.input;
+        benchmarks.push_back({string("parseCommand/") + alias.name, [&game] { stockRoom(game, 5); }, [&game, input] {
+            game.parseCommand(input);
+            game.out.clear();
+        }});
+    }
+
+    // search() on rooms of different sizes
+    for (int count : { 0, 5, 500 }) {
+        benchmarks.push_back({"search/" + to_string(count), [&game, count] { stockRoom(game, count); }, [&game] {
+            game.search();
+            game.out.clear();
+        }});
+    }
+
+    // The same turns for a machine client that reads only typed events
+    EngineConfig typedConfig = config;
+    typedConfig.text = false;
+    static Game typedGame(1, typedConfig);
+    typedGame.hasLight = true;
+    typedGame.currentRoom = 2;
+    typedGame.roomSearched[2] = true;
+    for (Game* target : { &game, &typedGame }) {
+        string mode = target == &game ? "text" : "typed";
+        benchmarks.push_back({"events/" + mode + "/search", [target] { stockRoom(*target, 5); }, [target] {
+            target->search();
+            target->out.clear();
+        }});
+        benchmarks.push_back({"events/" + mode + "/inventory", [target] { stockInventory(*target, Game::MAX_INVENTORY); }, [target] {
+            target->listInventory();
+            target->out.clear();
+        }});
+    }
+
+    // takeItem name resolution: a miss scans every item, a hit takes the
+    // last one and puts it straight back so the room stays the same size
+    for (int count : { 5, 500 }) {
+        benchmarks.push_back({"takeItem/miss/" + to_string(count), [&game, count] { stockRoom(game, count); stockInventory(game, 1); }, [&game] {
+            game.takeItem("flux capacitor");
+            game.out.clear();
+        }});
+        benchmarks.push_back({"takeItem/hit/" + to_string(count), [&game, count] { stockRoom(game, count); stockInventory(game, 1); }, [&game] {
+            game.takeItem("energy bar");
+            game.rooms[game.currentRoom].items.push_back(move(game.inventory.back()));
+            game.inventory.pop_back();
+            game.out.clear();
+        }});
+    }
+
+    benchmarks.push_back({"listInventory", [&game] { stockInventory(game, Game::MAX_INVENTORY); }, [&game] {
+        game.listInventory();
+        game.out.clear();
+    }});
+
+    // hint: a table lookup, and a state off the table (the Crowbar left
+    // in the Observation Deck) answered from the memo after the first search
+    benchmarks.push_back({"hint/table", nothing, [&game] {
+        game.showHint();
+        game.out.clear();
+    }});
+    static Game droppedGame(1, config);
+    droppedGame.hasLight = true;
+    droppedGame.currentRoom = 2;
+    droppedGame.rooms[0].items.erase(droppedGame.rooms[0].items.begin());
+    droppedGame.rooms[2].items.push_back(Item(ItemId::Crowbar));
+    benchmarks.push_back({"hint/memoized", nothing, [] {
+        droppedGame.showHint();
+        droppedGame.out.clear();
+    }});
+
+    benchmarks.push_back({"showMap", nothing, [&game] {
+        game.showMap();
+        game.out.clear();
+    }});
+
+    // A session's whole life on a churning host: a new game with the
+    // intro, then freed; and the same game reset in place for the next one
+    EngineConfig sessionConfig;
+    benchmarks.push_back({"session/create", nothing, [&sessionConfig] {
+        delete new Game(2, sessionConfig);
+    }});
+    static Game recycled(2, sessionConfig);
+    benchmarks.push_back({"session/reset", nothing, [&sessionConfig] {
+        recycled.reset(2, sessionConfig);
+    }});
+
+    vector<Sample> samples;
+    for (const Benchmark& benchmark : benchmarks) {
+        if (!filter.empty() && benchmark.name.find(filter) == string::npos) continue;
+        samples.push_back(run(benchmark, repetitions, minTimeNs));
+    }
+
+    char date[64];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+    fprintf(report,
+            "{\n"
+            "  \"context\": {\n"
+            "    \"date\": \"%s\",\n"
+            "    \"executable\": \"%s\",\n"
+            "    \"num_cpus\": %ld,\n"
+            "    \"library_build_type\": \"%s\"\n"
+            "  },\n"
+            "  \"benchmarks\": [\n",
+            date, argv[0], sysconf(_SC_NPROCESSORS_ONLN),
+#ifdef NDEBUG
+            "release"
+#else
+            "debug"
+#endif
+    );
+    for (size_t i = 0; i < samples.size(); i++) {
+        const Sample& sample = samples[i];
+        bool last = i + 1 == samples.size();
+        double m = mean(sample.nsPerOp);
+        printAggregate(report, sample, "mean", m, false);
+        printAggregate(report, sample, "median", percentile(sample.nsPerOp, 0.5), false);
+        printAggregate(report, sample, "stddev", stddev(sample.nsPerOp), false);
+        printAggregate(report, sample, "cv", m > 0 ? stddev(sample.nsPerOp) / m : 0, last);
+    }
+    fprintf(report, "  ]\n}\n");
+    fclose(report);
+    return 0;
+}
@@ -0,0 +1,62 @@
+// Session-size report: keeps many games alive at once, plays a random
+// number of everyday commands in each, then prints the heap bytes they hold
+// as totals per category and a histogram of session sizes. Use it to size
+// containers (players per GB) instead of guessing.
+//
+// Usage: ./session_report [sessions] [max commands per session]
+#include <cstdlib>
+#include <fcntl.h>
+
+#include "../station.h"
+
+using namespace std;
+
+// Commands that don't leave the first room or start a timed effect;
+// menu answers ride along as batch entries
+static const char* const COMMANDS[] = {
+    "search",
+    "take crowbar",
+    "take duct tape",
+    "take pressure gauge",
+    "d; 1",
+    "I",
+    "i",
+    "m",
+    "h",
+    "examine headlight",
+    "xyzzy",
+    "feel around",
+};
+
+int main(int argc, char** argv) {
+    int sessionCount = argc > 1 ? atoi(argv[1]) : 1000;
+    int maxCommands = argc > 2 ? atoi(argv[2]) : 50;
+    if (sessionCount <= 0 || maxCommands < 0) {
+        fprintf(stderr, "usage: %s [sessions] [max commands per session]\n", argv[0]);
+        return 2;
+    }
+    srand(1);
+
+    // Engines produce events rather than writing, so nothing is rendered
+    vector<unique_ptr<Engine>> sessions;
+    for (int i = 0; i < sessionCount; i++) {
+        sessions.push_back(Engine::create(i + 1));
+        Engine& engine = *sessions.back();
+        engine.step("");  // Dismiss the intro
+        engine.step("use headlight");
+        int commands = rand() % (maxCommands + 1);
+        for (int c = 0; c < commands; c++) {
+            engine.step(COMMANDS[rand() % (sizeof(COMMANDS) / sizeof(COMMANDS[0]))]);
+        }
+    }
+
+    MemoryHistogram histogram;
+    for (const unique_ptr<Engine>& engine : sessions) {
+        histogram.add(engine->memoryUsage());
+    }
+
+    OutputFrame report(STDOUT_FILENO);
+    histogram.report(report);
+    report.flush();
+    return 0;
+}
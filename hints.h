@@ -0,0 +1,237 @@
+// The model behind the 'hint' command: a small abstract game state (the
+// room, the milestones reached and where the key items are) and the steps
+// that carry it toward victory. tools/hint_table.cpp runs the model at build
+// time to produce hint_table.h, which holds the number of commands left to
+// win from every state where each key item is held or still in its starting
+// room. This header needs nothing from the engine, so the generator builds
+// without it.
+#ifndef STATION_HINTS_H
+#define STATION_HINTS_H
+
+#include <cstdint>
+
+// Items the way to the Control Room needs, by position in HintState::where.
+// game.h maps them to ItemIds and checks the starting rooms against
+// STARTING_ITEMS.
+const int HINT_ITEMS = 7;
+constexpr int HINT_START_ROOM[HINT_ITEMS] = {
+    0,  // Crowbar
+    0,  // Duct Tape
+    1,  // Glow Stick
+    1,  // Sticky Note with the door code
+    2,  // Blow Torch
+    2,  // Circuit Board
+    3,  // Butane Canister
+};
+const int HINT_ROOMS = 5;
+
+struct HintState {
+    static const uint8_t HELD = 0xFF;  // In place of a room number
+    static const uint8_t GONE = 0xFE;  // Another player has it, in a shared station
+
+    static const uint8_t LIGHT = 1 << 0;
+    static const uint8_t AIRLOCK_OPEN = 1 << 1;
+    static const uint8_t SUIT_TORN = 1 << 2;
+    static const uint8_t SUIT_SEALED = 1 << 3;
+    static const uint8_t OBSERVATION_OPEN = 1 << 4;
+    static const uint8_t HALL_DARK = 1 << 5;     // The Mess Hall has drained the headlight
+    static const uint8_t CONTROL_OPEN = 1 << 6;
+    static const int FLAG_BITS = 7;
+
+    uint8_t room = 0;
+    uint8_t flags = 0;
+    uint8_t where[HINT_ITEMS] = {};
+
+    bool is(uint8_t flag) const { return (flags & flag) != 0; }
+    bool holds(int item) const { return where[item] == HELD; }
+
+    // The first command in the Mess Hall always kills the headlight, so a
+    // state that has just arrived there is treated as already past that
+    void settle() {
+        if (room == 3 && !is(HALL_DARK)) {
+            flags = (flags | HALL_DARK) & ~LIGHT;
+        }
+    }
+
+    // Position in HINT_DISTANCE, or -1 if an item lies outside its
+    // starting room (dropped elsewhere)
+    int tableIndex() const {
+        int held = 0;
+        for (int i = 0; i < HINT_ITEMS; i++) {
+            if (holds(i)) held |= 1 << i;
+            else if (where[i] != HINT_START_ROOM[i]) return -1;
+        }
+        return ((room << FLAG_BITS | flags) << HINT_ITEMS) | held;
+    }
+
+    static HintState fromIndex(int index) {
+        HintState state;
+        for (int i = 0; i < HINT_ITEMS; i++) {
+            state.where[i] = (index >> i & 1) ? HELD : HINT_START_ROOM[i];
+        }
+        index >>= HINT_ITEMS;
+        state.flags = index & ((1 << FLAG_BITS) - 1);
+        state.room = index >> FLAG_BITS;
+        return state;
+    }
+
+    // Every field packed into one number, for memoizing states off the
+    // table. A location takes four bits (HELD becomes 0xF, GONE 0xE).
+    uint64_t key() const {
+        uint64_t key = (uint64_t)room << 8 | flags;
+        for (int i = 0; i < HINT_ITEMS; i++) key = key << 4 | (where[i] & 0xF);
+        return key;
+    }
+};
+
+const int HINT_TABLE_SIZE = HINT_ROOMS << (HintState::FLAG_BITS + HINT_ITEMS);
+const uint8_t HINT_UNREACHABLE = 0xFF;
+
+// What a hint can tell the player to do next. Where two plans are equally
+// short, the step listed first wins, so sealing a leak comes before all else.
+enum class HintStep : uint8_t {
+    SealSuit,
+    UseHeadlight,
+    UseGlowStick,
+    FindBatteries,
+    TakeCrowbar,  // One Take step per key item, in HINT_START_ROOM order
+    TakeDuctTape,
+    TakeGlowStick,
+    TakeCodeNote,
+    TakeBlowTorch,
+    TakeCircuitBoard,
+    TakeButane,
+    OpenAirlock,
+    EnterCorridor,
+    ApproachObservation,
+    UnlockObservation,
+    EnterObservation,
+    UnlockMessHall,
+    CutControlDoor,
+    EnterControl,
+    BackToAirlock,
+    BackToCorridor,
+    BackToObservation,
+    BackToMessHall,
+    RepairComputer,  // Wins the game
+    Count
+};
+
+struct HintStepInfo {
+    const char* advice;
+    int commands;  // Typed to carry it out, counting menu answers
+};
+
+// Indexed by HintStep
+constexpr HintStepInfo HINT_STEPS[] = {
+    { "Use the Duct Tape to seal the tear in your suit.", 1 },
+    { "Use the Headlight to light up your surroundings.", 1 },
+    { "Use the Glow Stick to light up your surroundings.", 1 },
+    { "Keep searching the dark Mess Hall; fresh batteries for your headlight are within reach.", 3 },
+    { "Take the Crowbar.", 1 },
+    { "Take the Duct Tape.", 1 },
+    { "Take the Glow Stick.", 1 },
+    { "Take the Sticky Note with the door code.", 1 },
+    { "Take the Blow Torch.", 1 },
+    { "Take the Circuit Board.", 1 },
+    { "Take the Butane Canister.", 1 },
+    { "Use the Crowbar to pry open the airlock door.", 1 },
+    { "Move through the open airlock door into the Maintenance Corridor.", 1 },
+    { "Move forward toward the Observation Deck.", 2 },
+    { "Move forward and enter the code from the Sticky Note at the Observation Deck terminal.", 3 },
+    { "Move forward to the Observation Deck.", 2 },
+    { "Move forward and enter the same code at the Mess Hall terminal.", 4 },
+    { "Use the Blow Torch with the Butane Canister to cut open the control room door.", 1 },
+    { "Move forward to the Control Room.", 2 },
+    { "Go back to the Airlock.", 2 },
+    { "Go back to the Maintenance Corridor.", 2 },
+    { "Go back to the Observation Deck.", 2 },
+    { "Go back to the Mess Hall.", 2 },
+    { "Access the main computer and answer its hex prompt; the Circuit Board will replace the failed part.", 2 },
+};
+static_assert(sizeof(HINT_STEPS) / sizeof(HINT_STEPS[0]) == (size_t)HintStep::Count, "HINT_STEPS must match HintStep");
+
+// Where the step leads from the given state; false if it can't be taken
+// there. RepairComputer leaves the state as it is: the game is won.
+inline bool applyHintStep(HintStep step, const HintState& from, HintState& to) {
+    to = from;
+    bool light = from.is(HintState::LIGHT);
+    bool canMove = light && !from.is(HintState::SUIT_TORN);
+    switch (step) {
+        case HintStep::UseHeadlight:
+            if (light || from.is(HintState::HALL_DARK)) return false;
+            to.flags |= HintState::LIGHT;
+            return true;
+        case HintStep::UseGlowStick:
+            if (light || !from.holds(2)) return false;
+            to.flags |= HintState::LIGHT;
+            return true;
+        case HintStep::FindBatteries:
+            if (light || from.room != 3) return false;
+            to.flags |= HintState::LIGHT;
+            return true;
+        case HintStep::OpenAirlock:
+            if (from.room != 0 || !from.holds(0) || from.is(HintState::AIRLOCK_OPEN)) return false;
+            to.flags |= HintState::AIRLOCK_OPEN;
+            return true;
+        case HintStep::EnterCorridor:
+            if (from.room != 0 || !light || !from.is(HintState::AIRLOCK_OPEN)) return false;
+            to.room = 1;
+            return true;
+        case HintStep::ApproachObservation:
+            if (from.room != 1 || !light || from.is(HintState::SUIT_TORN) || from.is(HintState::SUIT_SEALED)) return false;
+            to.flags |= HintState::SUIT_TORN;
+            return true;
+        case HintStep::SealSuit:
+            if (!from.is(HintState::SUIT_TORN) || !from.holds(1)) return false;
+            to.flags = (to.flags & ~HintState::SUIT_TORN) | HintState::SUIT_SEALED;
+            return true;
+        case HintStep::UnlockObservation:
+        case HintStep::EnterObservation: {
+            bool open = from.is(HintState::OBSERVATION_OPEN);
+            if (from.room != 1 || !canMove || !from.is(HintState::SUIT_SEALED)) return false;
+            if (step == HintStep::UnlockObservation ? open || !from.holds(3) : !open) return false;
+            to.flags |= HintState::OBSERVATION_OPEN;
+            to.room = 2;
+            return true;
+        }
+        case HintStep::UnlockMessHall:
+            if (from.room != 2 || !canMove || !from.holds(3)) return false;
+            to.room = 3;
+            to.settle();
+            return true;
+        case HintStep::CutControlDoor:
+            // The butane is used up; it stays "held" since nothing else needs it
+            if (from.room != 3 || !from.holds(4) || !from.holds(6) || from.is(HintState::CONTROL_OPEN)) return false;
+            to.flags |= HintState::CONTROL_OPEN;
+            return true;
+        case HintStep::EnterControl:
+            if (from.room != 3 || !canMove || !from.is(HintState::CONTROL_OPEN)) return false;
+            to.room = 4;
+            return true;
+        case HintStep::BackToAirlock:
+        case HintStep::BackToCorridor:
+        case HintStep::BackToObservation:
+        case HintStep::BackToMessHall: {
+            int room = (int)step - (int)HintStep::BackToAirlock;
+            if (from.room != room + 1 || !light) return false;
+            to.room = room;
+            return true;
+        }
+        case HintStep::RepairComputer:
+            return from.room == 4 && from.holds(5);
+        case HintStep::Count:
+            return false;
+        default: {
+            // Take: the corridor and airlock are too dark to find anything,
+            // and while the suit leaks only the Duct Tape is worth the time
+            int item = (int)step - (int)HintStep::TakeCrowbar;
+            if (from.where[item] != from.room || (!light && from.room < 2)) return false;
+            if (from.is(HintState::SUIT_TORN) && item != 1) return false;
+            to.where[item] = HintState::HELD;
+            return true;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,737 @@
+// HTTP/1.1 front end for the engine, independent of the socket loop that
+// drives it (see StationServer.cpp):
+//
+//     POST   /sessions               start a game; 201 with its ID and opening screen
+//     POST   /sessions/{id}/commands body is one line of input; 200 with the step
+//     DELETE /sessions/{id}          end a game early; 204
+//     POST   /stations               open a station several players share; 201 with its ID
+//     POST   /stations/{id}/sessions start a game in that station; as POST /sessions
+//     DELETE /stations/{id}          let no one else join; 204
+//     GET    /metrics                one JSON line of counters per shard
+//
+// Step output is the --json format (writeJsonLines), one object per line,
+// sent as application/x-ndjson. A session whose game is over, with no
+// undo left, is removed once its last step has been answered.
+//
+// Requests are parsed in place: the method, target and body are views into
+// the connection's read buffer, and the body goes to Engine::step as it
+// arrived. Connections are keep-alive, and pipelined requests are answered
+// in order from one buffer, as many per read as output room allows.
+//
+// A server can run several loops (shards), each with its own sessions. A
+// session ID names the shard that owns it, and a connection that asks for
+// a session on another shard is handed to that shard whole, buffered
+// requests and pending output included, and stays there.
+//
+// Stations are shared by every shard, so players on any shard can join
+// one; while they play, the station's room locks are all they share.
+#ifndef STATION_HTTP_H
+#define STATION_HTTP_H
+
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+
+#include "station.h"
+
+using namespace std;
+
+struct HttpRequest {
+    string_view method;
+    string_view path;    // Target without the query
+    string_view body;
+    bool keepAlive;
+};
+
+enum class HttpParse {
+    Done,
+    Incomplete,     // Read more
+    Invalid,        // 400
+    HeadTooLarge,   // 431
+    BodyTooLarge,   // 413
+    Unsupported     // 501: a transfer coding
+};
+
+const size_t HTTP_MAX_HEAD = 8192;
+const size_t HTTP_MAX_BODY = 4096;
+const int HTTP_MAX_BATCH = 16;  // Commands per request, so a reply fits its frame
+const int HTTP_MAX_SHARDS = 256;  // The top byte of a session ID
+
+inline bool httpEqualsIgnoreCase(string_view a, string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+    }
+    return true;
+}
+
+inline bool httpContainsToken(string_view list, string_view token) {
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        string_view item = list.substr(0, comma);
+        while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+        while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+        if (httpEqualsIgnoreCase(item, token)) return true;
+        if (comma == string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+// Parse the request at the start of the buffer. On Done, 'length' is its
+// size with the body, and the request's fields point into the buffer.
+inline HttpParse parseHttpRequest(string_view buffer, HttpRequest& request, size_t& length) {
+    size_t headEnd = buffer.find("\r\n\r\n");
+    if (headEnd == string_view::npos) {
+        return buffer.size() > HTTP_MAX_HEAD ? HttpParse::HeadTooLarge : HttpParse::Incomplete;
+    }
+    if (headEnd > HTTP_MAX_HEAD) {
+        return HttpParse::HeadTooLarge;
+    }
+    string_view head = buffer.substr(0, headEnd + 2);  // Every line ends in CRLF
+
+    // Request line: METHOD SP target SP HTTP/1.x
+    size_t lineEnd = head.find("\r\n");
+    string_view line = head.substr(0, lineEnd);
+    size_t space = line.find(' ');
+    size_t secondSpace = space == string_view::npos ? space : line.find(' ', space + 1);
+    if (space == 0 || secondSpace == string_view::npos) {
+        return HttpParse::Invalid;
+    }
+    string_view version = line.substr(secondSpace + 1);
+    if (version.size() != 8 || version.substr(0, 7) != "HTTP/1." || (version[7] != '0' && version[7] != '1')) {
+        return HttpParse::Invalid;
+    }
+    request.method = line.substr(0, space);
+    string_view target = line.substr(space + 1, secondSpace - space - 1);
+    if (target.empty() || target[0] != '/') {
+        return HttpParse::Invalid;
+    }
+    request.path = target.substr(0, target.find('?'));
+    request.keepAlive = version[7] == '1';
+
+    bool haveLength = false;
+    size_t bodyLength = 0;
+    for (size_t start = lineEnd + 2; start < head.size();) {
+        size_t end = head.find("\r\n", start);
+        string_view header = head.substr(start, end - start);
+        start = end + 2;
+        size_t colon = header.find(':');
+        if (colon == string_view::npos || colon == 0) {
+            return HttpParse::Invalid;
+        }
+        string_view name = header.substr(0, colon);
+        string_view value = header.substr(colon + 1);
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+
+        if (httpEqualsIgnoreCase(name, "Content-Length")) {
+            size_t parsed = 0;
+            if (value.empty() || value.size() > 9) return HttpParse::Invalid;
+            for (char c : value) {
+                if (c < '0' || c > '9') return HttpParse::Invalid;
+                parsed = parsed * 10 + (c - '0');
+            }
+            if (haveLength && parsed != bodyLength) return HttpParse::Invalid;
+            haveLength = true;
+            bodyLength = parsed;
+        } else if (httpEqualsIgnoreCase(name, "Transfer-Encoding")) {
+            return HttpParse::Unsupported;
+        } else if (httpEqualsIgnoreCase(name, "Connection")) {
+            if (httpContainsToken(value, "close")) request.keepAlive = false;
+            else if (httpContainsToken(value, "keep-alive")) request.keepAlive = true;
+        }
+    }
+
+    if (bodyLength > HTTP_MAX_BODY) {
+        return HttpParse::BodyTooLarge;
+    }
+    if (buffer.size() - head.size() - 2 < bodyLength) {
+        return HttpParse::Incomplete;
+    }
+    request.body = buffer.substr(head.size() + 2, bodyLength);
+    length = head.size() + 2 + bodyLength;
+    return HttpParse::Done;
+}
+
+// The error status for a request that can't be parsed
+inline int httpStatus(HttpParse parsed) {
+    switch (parsed) {
+        case HttpParse::HeadTooLarge: return 431;
+        case HttpParse::BodyTooLarge: return 413;
+        case HttpParse::Unsupported: return 501;
+        default: return 400;
+    }
+}
+
+inline const char* httpReason(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Content Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default: return "Error";
+    }
+}
+
+// Status line and headers; the body, if any, follows
+inline void writeHttpHead(OutputFrame& out, int status, size_t contentLength, bool keepAlive,
+                          const char* extraHeaders = "") {
+    out << "HTTP/1.1 " << status << " " << httpReason(status) << "\r\n";
+    if (contentLength > 0) {
+        out << "Content-Type: " << (status < 300 ? "application/x-ndjson" : "text/plain") << "\r\n";
+    }
+    if (status != 204) {
+        out << "Content-Length: " << contentLength << "\r\n";
+    }
+    out << string_view(extraHeaders);  // Copied: it may be built on the stack
+    if (!keepAlive) {
+        out << "Connection: close\r\n";
+    }
+    out << "\r\n";
+}
+
+inline void writeHttpError(OutputFrame& out, int status, bool keepAlive, const char* extraHeaders = "") {
+    const char* reason = httpReason(status);
+    writeHttpHead(out, status, strlen(reason) + 1, keepAlive, extraHeaders);
+    out << reason << "\n";
+}
+
+// Counters for one shard. Only its own loop writes them, so an update is a
+// plain load and store, and any thread may read them. Each shard's
+// counters fill their own cache line.
+struct alignas(64) ShardMetrics {
+    atomic<uint64_t> requests{0};
+    atomic<uint64_t> sessions{0};             // Open now
+    atomic<uint64_t> sessionsCreated{0};
+    atomic<uint64_t> connections{0};          // Open now
+    atomic<uint64_t> connectionsAccepted{0};
+    atomic<uint64_t> handoffsIn{0};           // Connections passed over from other shards
+    atomic<uint64_t> handoffsOut{0};
+    atomic<uint64_t> warmSessions{0};         // Started and waiting for a player
+    atomic<uint64_t> sessionsWarm{0};         // Created from a warm one
+
+    static void add(atomic<uint64_t>& counter, int64_t delta = 1) {
+        counter.store(counter.load(memory_order_relaxed) + delta, memory_order_relaxed);
+    }
+
+    static size_t read(const atomic<uint64_t>& counter) {
+        return counter.load(memory_order_relaxed);
+    }
+};
+
+struct Session {
+    unique_ptr<Engine> engine;
+    chrono::steady_clock::time_point lastUsed;
+    bool shared = false;  // In a shared station, which its engine keeps open
+};
+
+// Shared stations by ID, for all shards. Only opening and joining a
+// station take the lock here; play goes through the station's own rooms.
+class StationDirectory {
+    public:
+        static const size_t MAX_STATIONS = 100000;
+
+        // Add a new station under 'id'; false if the ID is taken or there
+        // are too many stations
+        bool open(uint64_t id) {
+            lock_guard<mutex> guard(lock);
+            if (stations.size() >= MAX_STATIONS || stations.count(id)) return false;
+            Entry& entry = stations[id];
+            entry.station = createSharedStation();
+            entry.lastJoined = chrono::steady_clock::now();
+            return true;
+        }
+
+        // The station to start a new player's game in; null if there is none
+        shared_ptr<SharedStation> join(uint64_t id) {
+            lock_guard<mutex> guard(lock);
+            auto found = stations.find(id);
+            if (found == stations.end()) return nullptr;
+            found->second.lastJoined = chrono::steady_clock::now();
+            return found->second.station;
+        }
+
+        // Players already in the station play on
+        bool close(uint64_t id) {
+            lock_guard<mutex> guard(lock);
+            return stations.erase(id) > 0;
+        }
+
+        // Close stations that nobody is playing in and nobody has joined
+        // for the idle timeout
+        void expire(chrono::steady_clock::time_point now, chrono::seconds idleTimeout) {
+            lock_guard<mutex> guard(lock);
+            for (auto it = stations.begin(); it != stations.end();) {
+                if (it->second.station.use_count() == 1 && now - it->second.lastJoined > idleTimeout) it = stations.erase(it);
+                else ++it;
+            }
+        }
+
+    private:
+        struct Entry {
+            shared_ptr<SharedStation> station;
+            chrono::steady_clock::time_point lastJoined;
+        };
+
+        mutex lock;
+        unordered_map<uint64_t, Entry> stations;
+};
+
+// The games behind one socket loop, and the routes above. Not thread-safe:
+// each loop owns its own. 'metrics' holds every shard's counters, this
+// one's at [shard]; 'stations' is shared by all of them.
+class SessionApi {
+    public:
+        static const size_t MAX_SESSIONS = 100000;  // Per shard
+        static const size_t MAX_SPARES = 256;       // Finished engines kept for new sessions
+        static const size_t WARM_BATCH = 8;         // Sessions warmed per idle loop iteration
+
+        SessionApi(chrono::seconds idleTimeout, size_t warmTarget, int shard, int shardCount, ShardMetrics* metrics,
+                   StationDirectory* stations)
+            : shard(shard), shardCount(shardCount), idleTimeout(idleTimeout), warmTarget(warmTarget), metrics(metrics),
+              stations(stations) {
+            random_device device;
+            randomState = (uint64_t)device() << 32 | device();
+        }
+
+        const int shard;
+        const int shardCount;
+
+        // The shard that owns the session a request names; this one for
+        // requests that don't name one
+        int owner(const HttpRequest& request) const {
+            uint64_t id;
+            if (!sessionPath(request.path, id)) return shard;
+            int owning = (int)(id >> 56);
+            return owning < shardCount ? owning : shard;  // Not a session ID we gave out: 404 here
+        }
+
+        // Write the whole response to a parsed request
+        void handle(const HttpRequest& request, OutputFrame& out) {
+            ShardMetrics::add(metrics[shard].requests);
+            const string_view prefix = "/sessions";
+            if (request.path == "/metrics") {
+                if (request.method != "GET") {
+                    writeHttpError(out, 405, request.keepAlive, "Allow: GET\r\n");
+                    return;
+                }
+                body.clear();
+                writeMetrics(body);
+                sendBody(out, 200, request.keepAlive);
+                return;
+            }
+            if (request.path == prefix) {
+                if (request.method != "POST") {
+                    writeHttpError(out, 405, request.keepAlive, "Allow: POST\r\n");
+                    return;
+                }
+                createSession(request, out);
+                return;
+            }
+            if (request.path.substr(0, 9) == "/stations") {
+                handleStation(request, out);
+                return;
+            }
+
+            // /sessions/{id} and /sessions/{id}/commands
+            uint64_t id;
+            if (!sessionPath(request.path, id)) {
+                writeHttpError(out, 404, request.keepAlive);
+                return;
+            }
+            string_view rest = request.path.substr(prefix.size() + 17);
+            if (rest.empty()) {
+                if (request.method != "DELETE") {
+                    writeHttpError(out, 405, request.keepAlive, "Allow: DELETE\r\n");
+                } else if (!remove(sessions.find(id))) {
+                    writeHttpError(out, 404, request.keepAlive);
+                } else {
+                    writeHttpHead(out, 204, 0, request.keepAlive);
+                }
+            } else if (rest == "/commands") {
+                if (request.method != "POST") {
+                    writeHttpError(out, 405, request.keepAlive, "Allow: POST\r\n");
+                } else {
+                    runCommands(id, request, out);
+                }
+            } else {
+                writeHttpError(out, 404, request.keepAlive);
+            }
+        }
+
+        // Drop games nobody has touched for the idle timeout
+        void expire(chrono::steady_clock::time_point now) {
+            for (auto it = sessions.begin(); it != sessions.end();) {
+                if (now - it->second.lastUsed > idleTimeout) {
+                    retire(it->second);
+                    it = sessions.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            metrics[shard].sessions.store(sessions.size(), memory_order_relaxed);
+            stations->expire(now, idleTimeout);
+        }
+
+        // Whether the warm pool is short; the loop then polls instead of
+        // sleeping, and warms sessions while nothing else is ready
+        bool wantsWarming() const {
+            return warm.size() < warmTarget;
+        }
+
+        // Start up to 'count' games ahead of the players who will ask for
+        // them, so a new session only takes one off the pool
+        void warmUp(size_t count) {
+            for (size_t i = 0; i < count && warm.size() < warmTarget; i++) {
+                WarmSession ready;
+                ready.id = newId();
+                ready.engine = startEngine(ready.id);
+                warm.push_back(move(ready));
+            }
+            metrics[shard].warmSessions.store(warm.size(), memory_order_relaxed);
+        }
+
+        // Every shard's counters as JSON lines
+        void writeMetrics(OutputFrame& out) const {
+            for (int i = 0; i < shardCount; i++) {
+                const ShardMetrics& m = metrics[i];
+                out << "{\"type\":\"shard\",\"shard\":" << i << ",\"requests\":" << ShardMetrics::read(m.requests)
+                    << ",\"sessions\":" << ShardMetrics::read(m.sessions)
+                    << ",\"sessionsCreated\":" << ShardMetrics::read(m.sessionsCreated)
+                    << ",\"connections\":" << ShardMetrics::read(m.connections)
+                    << ",\"connectionsAccepted\":" << ShardMetrics::read(m.connectionsAccepted)
+                    << ",\"handoffsIn\":" << ShardMetrics::read(m.handoffsIn)
+                    << ",\"handoffsOut\":" << ShardMetrics::read(m.handoffsOut)
+                    << ",\"warmSessions\":" << ShardMetrics::read(m.warmSessions)
+                    << ",\"sessionsWarm\":" << ShardMetrics::read(m.sessionsWarm) << "}\n";
+            }
+        }
+
+    private:
+        struct WarmSession {
+            uint64_t id;
+            unique_ptr<Engine> engine;  // At the intro prompt
+        };
+
+        unordered_map<uint64_t, Session> sessions;
+        vector<unique_ptr<Engine>> spares;  // Reset in place for the next session
+        vector<WarmSession> warm;           // Newest last, so the next one is cache-warm
+        string intro;                       // A new session's opening lines, the same for every game
+        chrono::seconds idleTimeout;
+        size_t warmTarget;
+        ShardMetrics* metrics;
+        StationDirectory* stations;
+        uint64_t randomState;
+        OutputFrame body{-1};  // The response body, measured before its head is written
+
+        // splitmix64: session IDs and seeds that don't repeat or line up
+        uint64_t nextRandom() {
+            uint64_t z = (randomState += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            return z ^ (z >> 31);
+        }
+
+        static bool parseId(string_view text, uint64_t& id) {
+            id = 0;
+            for (char c : text) {
+                int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+                if (digit < 0) return false;
+                id = id << 4 | digit;
+            }
+            return true;
+        }
+
+        // The ID in /sessions/{id} or /sessions/{id}/...
+        static bool sessionPath(string_view path, uint64_t& id) {
+            return idPath(path, "/sessions/", id);
+        }
+
+        // The ID in {prefix}{id} or {prefix}{id}/...
+        static bool idPath(string_view path, string_view prefix, uint64_t& id) {
+            return path.size() >= prefix.size() + 16 && path.substr(0, prefix.size()) == prefix &&
+                   parseId(path.substr(prefix.size(), 16), id) &&
+                   (path.size() == prefix.size() + 16 || path[prefix.size() + 16] == '/');
+        }
+
+        static void writeId(OutputFrame& out, uint64_t id) {
+            char text[17];
+            snprintf(text, sizeof(text), "%016llx", (unsigned long long)id);
+            out << string_view(text, 16);
+        }
+
+        // /stations, /stations/{id} and /stations/{id}/sessions
+        void handleStation(const HttpRequest& request, OutputFrame& out) {
+            const string_view prefix = "/stations";
+            if (request.path == prefix) {
+                if (request.method != "POST") {
+                    writeHttpError(out, 405, request.keepAlive, "Allow: POST\r\n");
+                    return;
+                }
+                uint64_t id = nextRandom();
+                for (int tries = 1; !stations->open(id); tries++) {
+                    if (tries == 8) {  // Full, not unlucky
+                        writeHttpError(out, 503, request.keepAlive);
+                        return;
+                    }
+                    id = nextRandom();
+                }
+                body.clear();
+                body << "{\"type\":\"station\",\"id\":\"";
+                writeId(body, id);
+                body << "\"}\n";
+                char location[48];
+                snprintf(location, sizeof(location), "Location: /stations/%016llx\r\n", (unsigned long long)id);
+                sendBody(out, 201, request.keepAlive, location);
+                return;
+            }
+
+            uint64_t id;
+            if (!idPath(request.path, "/stations/", id)) {
+                writeHttpError(out, 404, request.keepAlive);
+                return;
+            }
+            string_view rest = request.path.substr(prefix.size() + 17);
+            if (rest.empty()) {
+                if (request.method != "DELETE") {
+                    writeHttpError(out, 405, request.keepAlive, "Allow: DELETE\r\n");
+                } else if (!stations->close(id)) {
+                    writeHttpError(out, 404, request.keepAlive);
+                } else {
+                    writeHttpHead(out, 204, 0, request.keepAlive);
+                }
+            } else if (rest == "/sessions") {
+                shared_ptr<SharedStation> station;
+                if (request.method != "POST") {
+                    writeHttpError(out, 405, request.keepAlive, "Allow: POST\r\n");
+                } else if (!(station = stations->join(id))) {
+                    writeHttpError(out, 404, request.keepAlive);
+                } else {
+                    createSession(request, out, move(station));
+                }
+            } else {
+                writeHttpError(out, 404, request.keepAlive);
+            }
+        }
+
+        // A new game, alone or in 'station'; warm games are for playing alone
+        void createSession(const HttpRequest& request, OutputFrame& out, shared_ptr<SharedStation> station = nullptr) {
+            if (sessions.size() >= MAX_SESSIONS) {
+                writeHttpError(out, 503, request.keepAlive);
+                return;
+            }
+            bool shared = station != nullptr;
+            WarmSession ready;
+            if (!shared && !warm.empty()) {
+                if (!sessions.count(warm.back().id)) {
+                    ready = move(warm.back());
+                    ShardMetrics::add(metrics[shard].sessionsWarm);
+                }
+                warm.pop_back();
+                metrics[shard].warmSessions.store(warm.size(), memory_order_relaxed);
+            }
+            if (!ready.engine) {
+                ready.id = newId();
+                ready.engine = startEngine(ready.id, move(station));
+            }
+            uint64_t id = ready.id;
+            Session& session = sessions[id];
+            session.shared = shared;
+            session.engine = move(ready.engine);
+            session.lastUsed = chrono::steady_clock::now();
+            ShardMetrics::add(metrics[shard].sessions);
+            ShardMetrics::add(metrics[shard].sessionsCreated);
+
+            if (intro.empty()) {
+                body.clear();
+                writeJsonLines(body, session.engine->result());
+                for (const Event* event = body.data(); event != body.data() + body.size(); event++) {
+                    intro += event->text;
+                }
+            }
+            body.clear();
+            body << "{\"type\":\"session\",\"id\":\"";
+            writeId(body, id);
+            body << "\"}\n";
+            body.ref(intro);
+
+            char location[48];
+            snprintf(location, sizeof(location), "Location: /sessions/%016llx\r\n", (unsigned long long)id);
+            sendBody(out, 201, request.keepAlive, location);
+        }
+
+        void runCommands(uint64_t id, const HttpRequest& request, OutputFrame& out) {
+            auto found = sessions.find(id);
+            if (found == sessions.end()) {
+                writeHttpError(out, 404, request.keepAlive);
+                return;
+            }
+            // Entries with something besides spaces in them; blank ones cost nothing
+            int entries = 0;
+            bool blank = true;
+            for (char c : request.body) {
+                if (c == ';' || c == '\n') {
+                    blank = true;
+                } else if (blank && !isspace((unsigned char)c)) {
+                    blank = false;
+                    entries++;
+                }
+            }
+            if (entries > HTTP_MAX_BATCH) {
+                writeHttpError(out, 413, request.keepAlive);
+                return;
+            }
+
+            Engine& engine = *found->second.engine;
+            found->second.lastUsed = chrono::steady_clock::now();
+            StepResult result = engine.step(request.body);
+            body.clear();
+            writeJsonLines(body, result);
+            sendBody(out, 200, request.keepAlive);
+            if (result.status != GameStatus::Running && result.undoSteps == 0) {
+                remove(found);  // Over, and no way back in
+            }
+        }
+
+        // An ID no session here has, naming this shard as the owner
+        uint64_t newId() {
+            uint64_t id;
+            do {
+                id = (nextRandom() & ~(0xFFULL << 56)) | (uint64_t)shard << 56;
+            } while (sessions.count(id));
+            return id;
+        }
+
+        // A game at its intro prompt, on a retired engine if there is one
+        unique_ptr<Engine> startEngine(uint64_t id, shared_ptr<SharedStation> station = nullptr) {
+            EngineConfig config;
+            config.sessionId = id;
+            config.station = move(station);
+            if (spares.empty()) return Engine::create(nextRandom(), config);
+            unique_ptr<Engine> engine = move(spares.back());
+            spares.pop_back();
+            engine->reset(nextRandom(), config);
+            return engine;
+        }
+
+        bool remove(unordered_map<uint64_t, Session>::iterator found) {
+            if (found == sessions.end()) return false;
+            retire(found->second);
+            sessions.erase(found);
+            ShardMetrics::add(metrics[shard].sessions, -1);
+            return true;
+        }
+
+        // Keep a finished game's engine, and the memory it holds, for the
+        // next session instead of freeing it
+        void retire(Session& session) {
+            if (spares.size() < MAX_SPARES && !session.shared) spares.push_back(move(session.engine));
+        }
+
+        // Head and body, copying the body out of the scratch frame
+        void sendBody(OutputFrame& out, int status, bool keepAlive, const char* extraHeaders = "") {
+            writeHttpHead(out, status, body.pendingBytes(), keepAlive, extraHeaders);
+            for (const Event* event = body.data(); event != body.data() + body.size(); event++) {
+                out << event->text;
+            }
+        }
+};
+
+// One client connection: its read buffer and pending output, whatever loop
+// drives the socket
+class HttpConnection {
+    public:
+        static const size_t READ_CHUNK = 16384;
+        static const size_t MAX_BUFFERED = 65536;  // Pipelined input read ahead of the answers
+
+        // The loop must never wait on one reader, so a frame that would have
+        // to drain cuts its reader off at once
+        explicit HttpConnection(int descriptor) : fd(descriptor), out(descriptor, 0) {
+            in.resize(READ_CHUNK);
+        }
+
+        const int fd;
+        OutputFrame out;
+        bool closing = false;     // Close once the output is out
+        bool inputEnded = false;  // The client shut down its side
+        int handoffTo = -1;       // The shard to pass this connection to, before anything more
+        chrono::steady_clock::time_point lastActive = chrono::steady_clock::now();
+
+        // Room for the next read, grown as a request needs
+        char* readSpace(size_t& available) {
+            if (in.size() - used < READ_CHUNK / 2) in.resize(in.size() + READ_CHUNK);
+            available = in.size() - used;
+            return in.data() + used;
+        }
+
+        void received(size_t count) {
+            used += count;
+            lastActive = chrono::steady_clock::now();
+        }
+
+        // Answer the complete requests buffered, in order, until output
+        // backs up; the rest wait for the next call. Stopping at the high
+        // water mark leaves room in the frame for one more answer, so it
+        // never has to drain. False if nothing was taken from the buffer.
+        bool serve(SessionApi& api) {
+            size_t start = 0;
+            handoffTo = -1;
+            while (!closing && !out.overHighWater()) {
+                HttpRequest request;
+                size_t length;
+                HttpParse parsed = parseHttpRequest(string_view(in.data() + start, used - start), request, length);
+                if (parsed == HttpParse::Incomplete) {
+                    break;
+                }
+                if (parsed != HttpParse::Done) {
+                    writeHttpError(out, httpStatus(parsed), false);  // The stream can't be trusted past here
+                    closing = true;
+                    start = used;
+                    break;
+                }
+                int owner = api.owner(request);
+                if (owner != api.shard) {
+                    handoffTo = owner;  // That shard answers this request and the rest
+                    break;
+                }
+                api.handle(request, out);
+                closing = !request.keepAlive;
+                start += length;
+            }
+            // Keep what is left of a partial request at the front
+            memmove(in.data(), in.data() + start, used - start);
+            used -= start;
+            if (used == 0 && in.size() > READ_CHUNK) {
+                in.resize(READ_CHUNK);
+                in.shrink_to_fit();
+            }
+            return start > 0;
+        }
+
+        // Requests are waiting but output room ran out
+        bool hasBuffered() const {
+            return used > 0;
+        }
+
+        // Worth reading more: staying here, not closing, and neither side
+        // backed up
+        bool wantsInput() const {
+            return handoffTo < 0 && !closing && used < MAX_BUFFERED && !out.overHighWater();
+        }
+
+    private:
+        vector<char> in;
+        size_t used = 0;
+};
+
+#endif
@@ -0,0 +1,125 @@
+// Replay files: a session recorded compactly enough to keep for every game,
+// and exact enough to reproduce it turn by turn. A game is its seed, its
+// config and its inputs, so that is all a replay stores, plus a snapshot of
+// the engine every CHECKPOINT_TURNS inputs so a viewer can jump to any turn
+// without playing the whole game again.
+//
+//     file       "STRP" version header record* [index trailer]
+//     header     varint seed, varint oxygenCommands, varint undoDepth, u8 showIntro
+//     record     varint code, then
+//                  code 0: checkpoint  varint turn, varint ms, varint length, Engine::snapshot()
+//                  code 1: index       varint turns, varint ms, varint count, count * (varint turn, varint offset)
+//                  code 2+: input      varint delay ms; code - 2 is the input's command ID
+//     trailer    u64 offset of the index record, "STRX"
+//
+// A command ID numbers the distinct input lines of a segment (the records
+// since the last checkpoint); the first use of a new ID is followed by
+// varint length and the text. So a repeated command costs two bytes, and
+// decoding can start at any checkpoint. Varints are LEB128. A file cut off
+// before its index (a crash) is still readable; the index is rebuilt by
+// scanning.
+#ifndef STATION_REPLAY_H
+#define STATION_REPLAY_H
+
+#include "station.h"
+
+class ReplayWriter {
+    public:
+        static const long CHECKPOINT_TURNS = 64;
+        static const size_t FLUSH_BYTES = 4096;  // Buffered before a write
+
+        // Record a game created with this seed and config to the descriptor,
+        // which stays the caller's
+        ReplayWriter(int descriptor, uint64_t seed, const EngineConfig& config);
+
+        // finish()es if not done yet
+        ~ReplayWriter();
+
+        // Call with each input before passing it to engine.step()
+        void record(const Engine& engine, std::string_view input);
+
+        // Write the index; nothing can be recorded after. False if any write failed.
+        bool finish();
+
+        ReplayWriter(const ReplayWriter&) = delete;
+        ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    private:
+        int fd;
+        std::string buffer;                   // Not yet written
+        uint64_t written = 0;                 // Bytes already in the file
+        long turn = 0;                        // Inputs recorded
+        uint64_t startMs, lastMs;
+        std::vector<std::string> commands;    // This segment's command IDs
+        std::vector<std::pair<long, uint64_t>> checkpoints;  // Turn and file offset
+        bool failed = false;
+        bool finished = false;
+
+        void flush();
+};
+
+// Plays a replay file back through an engine with display text off, so it
+// runs at memory speed. seek() restores the nearest checkpoint at or before
+// the turn and steps the rest.
+class ReplayPlayer {
+    public:
+        // Check ok() before anything else
+        explicit ReplayPlayer(std::string file);
+
+        // The file is a replay this build can play
+        bool ok() const { return engine != NULL; }
+
+        uint64_t seed() const { return gameSeed; }
+        const EngineConfig& config() const { return gameConfig; }
+        long turns() const { return turnCount; }             // Inputs recorded
+        uint64_t durationMs() const { return recordedMs; }   // From start to the last input
+        size_t checkpoints() const { return index.size(); }
+
+        // Go to just after the given number of inputs; false if out of range
+        // or the file ends before it. 'played' counts the steps it took.
+        bool seek(long turn, long* played = NULL);
+
+        // Play the next input; false at the end
+        bool step();
+
+        long turn() const { return position; }        // Inputs played so far
+        std::string_view input() const { return lastInput; }  // The one played last
+        uint64_t timeMs() const { return elapsedMs; }  // When it was typed, from the start
+
+        Engine& game() { return *engine; }
+        StepResult result() const { return last; }
+
+    private:
+        std::string bytes;
+        uint64_t gameSeed = 0;
+        EngineConfig gameConfig;
+        long turnCount = 0;
+        uint64_t recordedMs = 0;
+        size_t recordsStart = 0;
+        size_t recordsEnd = 0;
+        std::vector<std::pair<long, size_t>> index;  // Checkpoint turn and offset
+
+        std::unique_ptr<Engine> engine;
+        StepResult last;
+        size_t next = 0;                      // Offset of the next record
+        long position = 0;
+        uint64_t elapsedMs = 0;
+        std::string_view lastInput;
+        std::vector<std::string_view> commands;  // This segment's command IDs
+
+        struct Record {
+            bool checkpoint;
+            std::string_view input;  // An input's text
+            uint64_t delayMs;        // Since the input before
+            long turn;               // A checkpoint's position
+            uint64_t ms;
+            std::string_view image;
+        };
+
+        bool readRecord(size_t& offset, Record& record);
+        bool readIndex();
+        void scan();
+        void rewind();
+};
+
+#endif
@@ -0,0 +1,210 @@
+// Size-class slab allocator for session memory: Game and Engine objects,
+// the room table, the output frame's and turn arena's blocks and the undo
+// history's buffers. A host that churns through many sessions reuses the
+// same few block sizes over and over, so they come from free lists instead
+// of malloc.
+//
+// Sizes are rounded up to a power of two from 16 bytes to 16 KB; anything
+// larger goes to operator new. Each thread keeps one free list per size
+// class, so allocating and freeing take no lock and touch no other core's
+// cache lines. A list refills from a shared depot, or from a new 64 KB
+// slab, a slab's worth of blocks at a time, and returns that much to the
+// depot when it holds more than two slabs' worth. A thread's lists go to
+// the depot when it exits. Slabs are kept for the life of the process.
+#ifndef STATION_SLAB_H
+#define STATION_SLAB_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+
+class Slab {
+    public:
+        static const size_t MIN_BLOCK = 16;
+        static const size_t MAX_BLOCK = 16384;
+        static const int CLASSES = 11;             // 16 B to 16 KB
+        static const size_t SLAB_BYTES = 65536;
+
+        static void* allocate(size_t size) {
+            if (size > MAX_BLOCK) {
+                return ::operator new(size);
+            }
+            int sizeClass = classOf(size);
+            FreeList& list = lists[sizeClass];
+            if (!list.head) {
+                refill(sizeClass, list);
+            }
+            handedOut++;
+            Block* block = list.head;
+            list.head = block->next;
+            list.count--;
+            return block;
+        }
+
+        // 'size' is the size the block was allocated with
+        static void release(void* pointer, size_t size) {
+            if (!pointer) {
+                return;
+            }
+            if (size > MAX_BLOCK) {
+                ::operator delete(pointer);
+                return;
+            }
+            int sizeClass = classOf(size);
+            FreeList& list = lists[sizeClass];
+            Block* block = static_cast<Block*>(pointer);
+            block->next = list.head;
+            list.head = block;
+            list.count++;
+            if (list.count > 2 * blocksPerSlab(sizeClass)) {
+                spill(sizeClass, list, blocksPerSlab(sizeClass));
+            }
+        }
+
+        // Bytes taken from the system for slabs, by all threads
+        static size_t slabBytes() {
+            return depot().slabBytes.load(std::memory_order_relaxed);
+        }
+
+        // Bytes a request of 'size' really holds: a whole block of its class
+        static size_t blockBytes(size_t size) {
+            if (size == 0) return 0;
+            return size > MAX_BLOCK ? size : blockSize(classOf(size));
+        }
+
+        // Blocks of up to MAX_BLOCK this thread has taken, from a free list
+        // or a new slab; larger sizes are counted by operator new
+        static size_t allocations() {
+            return handedOut;
+        }
+
+    private:
+        struct Block {
+            Block* next;
+        };
+
+        struct FreeList {
+            Block* head;
+            size_t count;
+        };
+
+        // Free blocks shared between threads
+        struct Depot {
+            std::mutex lock;
+            FreeList lists[CLASSES] = {};
+            std::atomic<size_t> slabBytes{0};
+        };
+
+        // Hands the thread's free blocks to the depot when the thread exits
+        struct ThreadExit {
+            ~ThreadExit() {
+                for (int sizeClass = 0; sizeClass < CLASSES; sizeClass++) {
+                    spill(sizeClass, lists[sizeClass], lists[sizeClass].count);
+                }
+            }
+        };
+
+        // Plain data, so frees that come after ThreadExit still work
+        inline static thread_local FreeList lists[CLASSES] = {};
+        inline static thread_local size_t handedOut = 0;
+
+        static Depot& depot() {
+            static Depot* shared = new Depot;  // Never destroyed: blocks may be freed during exit
+            return *shared;
+        }
+
+        static int classOf(size_t size) {
+            int sizeClass = 0;
+            for (size_t block = MIN_BLOCK; block < size; block <<= 1) sizeClass++;
+            return sizeClass;
+        }
+
+        static size_t blockSize(int sizeClass) {
+            return MIN_BLOCK << sizeClass;
+        }
+
+        static size_t blocksPerSlab(int sizeClass) {
+            return SLAB_BYTES / blockSize(sizeClass);
+        }
+
+        static void refill(int sizeClass, FreeList& list) {
+            static thread_local ThreadExit exitHook;
+            (void)exitHook;
+            Depot& shared = depot();
+            {
+                std::lock_guard<std::mutex> guard(shared.lock);
+                FreeList& spare = shared.lists[sizeClass];
+                for (size_t taken = 0; spare.head && taken < blocksPerSlab(sizeClass); taken++) {
+                    Block* block = spare.head;
+                    spare.head = block->next;
+                    spare.count--;
+                    block->next = list.head;
+                    list.head = block;
+                    list.count++;
+                }
+            }
+            if (list.head) {
+                return;
+            }
+            char* slab = static_cast<char*>(::operator new(SLAB_BYTES));
+            shared.slabBytes.fetch_add(SLAB_BYTES, std::memory_order_relaxed);
+            size_t size = blockSize(sizeClass);
+            for (size_t offset = SLAB_BYTES; offset >= size; offset -= size) {
+                Block* block = reinterpret_cast<Block*>(slab + offset - size);
+                block->next = list.head;
+                list.head = block;
+                list.count++;
+            }
+        }
+
+        // Move 'count' blocks from the front of a thread's list to the depot
+        static void spill(int sizeClass, FreeList& list, size_t count) {
+            if (count == 0) {
+                return;
+            }
+            Block* first = list.head;
+            Block* last = first;
+            for (size_t i = 1; i < count; i++) last = last->next;
+            list.head = last->next;
+            list.count -= count;
+            Depot& shared = depot();
+            std::lock_guard<std::mutex> guard(shared.lock);
+            last->next = shared.lists[sizeClass].head;
+            shared.lists[sizeClass].head = first;
+            shared.lists[sizeClass].count += count;
+        }
+};
+
+// Standard allocator over Slab, for containers that hold session memory
+template <typename T>
+struct SlabAllocator {
+    typedef T value_type;
+
+    SlabAllocator() = default;
+
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U>&) {
+    }
+
+    T* allocate(size_t count) {
+        return static_cast<T*>(Slab::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t count) {
+        Slab::release(pointer, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const SlabAllocator<U>&) const {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const SlabAllocator<U>&) const {
+        return false;
+    }
+};
+
+#endif
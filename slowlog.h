@@ -0,0 +1,80 @@
+// The slow-command log. An engine configured with a SlowLog (see
+// EngineConfig) profiles every step; one that takes longer than the log's
+// threshold is copied into a SlowCommand and handed to the log's own
+// thread, which writes it as one JSON line, e.g.
+//     {"session":7,"turn":12,"input":"search","verb":"search","handler":"search",
+//      "state":{"room":3,"flags":["airlockDoorOpen"],"inventory":[0,1,19]},
+//      "us":2514.031,"phases":{"parseCommand":{"us":2511.870,"calls":1},...},
+//      "output_bytes":812,"events":14}
+// The slow session only waits for a short queue lock, never for the disk.
+// When the writer falls MAX_QUEUED entries behind, further ones are dropped
+// and counted instead.
+#ifndef STATION_SLOWLOG_H
+#define STATION_SLOWLOG_H
+
+#include <condition_variable>
+#include <string>
+#include <thread>
+
+#include "trace.h"
+
+// The game after a slow step, small enough to copy under the queue lock
+struct StateDigest {
+    static const int MAX_ITEMS = 16;
+
+    int room = 0;
+    uint32_t flags = 0;  // Bit i is STATE_FLAGS[i] (game.h)
+    uint8_t inventory[MAX_ITEMS];  // ItemIds
+    int inventoryCount = 0;
+};
+
+struct SlowCommand {
+    uint64_t session;
+    long long turn;       // Inputs the session had taken before this step
+    std::string input;    // As typed, batch separators included
+    const char* verb;     // Of the first command: a Verb name, "answer" or "undo"
+    const char* prompt;   // For "answer", the question answered; else NULL
+    uint64_t duration;    // Nanoseconds for the whole step
+    CommandProfile profile;
+    StateDigest state;
+    size_t outputBytes;   // Display text the step produced
+    size_t events;        // Output events, typed ones included
+};
+
+class SlowLog {
+    public:
+        static const size_t MAX_QUEUED = 1024;
+
+        // Log steps of at least thresholdUs to the descriptor, which the
+        // caller keeps open until the log is destroyed
+        SlowLog(int descriptor, uint64_t thresholdUs);
+
+        // Writes whatever is still queued, then stops the thread
+        ~SlowLog();
+
+        uint64_t threshold() const {
+            return thresholdNs;
+        }
+
+        void submit(SlowCommand&& command);
+
+        // Entries lost because the writer was too far behind
+        size_t dropped() const;
+
+        SlowLog(const SlowLog&) = delete;
+        SlowLog& operator=(const SlowLog&) = delete;
+
+    private:
+        void run();
+
+        const int fd;
+        const uint64_t thresholdNs;
+        mutable std::mutex lock;
+        std::condition_variable wake;
+        std::vector<SlowCommand> queue;
+        size_t droppedCount = 0;
+        bool stopping = false;
+        std::thread writer;  // Last, so it starts once the rest is ready
+};
+
+#endif
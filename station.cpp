@@ -0,0 +1,699 @@
+// libstation: the Engine facade over Game
+#include "game.h"
+#include "replay.h"
+
+Engine::Engine(unique_ptr<Game> game, const EngineConfig& config)
+    : game(move(game)), slowLog(config.slowLog), sessionId(config.sessionId) {
+}
+
+Engine::~Engine() {
+}
+
+unique_ptr<Engine> Engine::create(uint64_t seed, const EngineConfig& config) {
+    return unique_ptr<Engine>(new Engine(unique_ptr<Game>(new Game(seed, config)), config));
+}
+
+shared_ptr<SharedStation> createSharedStation() {
+    return make_shared<SharedStation>();
+}
+
+void Engine::reset(uint64_t seed, const EngineConfig& config) {
+    game->reset(seed, config);
+    slowLog = config.slowLog;
+    sessionId = config.sessionId;
+}
+
+StepResult Engine::step(string_view input) {
+    TraceScope trace("step");
+    game->out.clear();  // The previous step's events have been rendered
+    if (slowLog) {
+        return profiledStep(input);
+    }
+    game->runBatch(input);
+    return result();
+}
+
+// A step timed phase by phase. Only a slow one costs more than the clock
+// reads: it is copied out for the slow-command log.
+StepResult Engine::profiledStep(string_view input) {
+    CommandProfile profile;
+    Prompt asked = game->prompt;
+    long long turn = game->turns;
+    uint64_t start = traceClock();
+    {
+        ProfileScope active(profile);
+        game->runBatch(input);
+    }
+    uint64_t duration = traceClock() - start;
+    if (duration >= slowLog->threshold()) {
+        SlowCommand command;
+        command.session = sessionId;
+        command.turn = turn;
+        command.input = string(input);
+        game->describeInput(input, asked, command);
+        command.duration = duration;
+        command.profile = profile;
+        command.state = game->digest();
+        command.outputBytes = game->out.pendingBytes();
+        command.events = game->out.size();
+        slowLog->submit(move(command));
+    }
+    return result();
+}
+
+StepResult Engine::result() const {
+    StepResult result;
+    result.events = game->out.data();
+    result.eventCount = game->out.size();
+    result.status = game->status;
+    result.prompt = game->promptState();
+    result.undoSteps = game->history.size();
+    return result;
+}
+
+string Engine::save() const {
+    StateWriter writer;
+    game->visit(writer);
+    return writer.text;
+}
+
+// Enough of a loaded state to play on without going out of bounds
+static bool playable(const GameState& state) {
+    return state.currentRoom >= 0 && state.currentRoom < (int)state.rooms.size() &&
+           state.roomFirstVisit.size() == state.rooms.size() && state.roomSearched.size() == state.rooms.size() &&
+           state.status >= GameStatus::Running && state.status <= GameStatus::Disconnected &&
+           state.deathCause >= DeathCause::None && state.deathCause <= DeathCause::SuitSuffocation &&
+           state.prompt >= Prompt::Command && state.prompt <= Prompt::EndSession;
+}
+
+bool Engine::load(string_view saved) {
+    if (game->station) {
+        return false;  // The room items in a save may since have been taken by others
+    }
+    // Read into a copy so a bad save can't leave the game half loaded
+    GameState state = *game;
+    StateReader reader(saved);
+    state.visit(reader);
+    if (!reader.ok || !playable(state)) {
+        return false;
+    }
+    static_cast<GameState&>(*game) = move(state);
+    game->history.clear();
+    game->out.clear();
+    game->arena.reset();
+    game->clearScreen();
+    game->wrapText(game->arena.concat({"Current Location: ", game->rooms[game->currentRoom].name}), true, "info");
+    game->out << "\n";
+    return true;
+}
+
+string Engine::snapshot() const {
+    string image;
+    ByteBuffer state;
+    SnapshotWriter writer(state);
+    game->visit(writer);
+    putBytes(image, state.data(), state.size());
+    putValue(image, (int64_t)game->turns);
+    game->history.save(image);
+    return image;
+}
+
+bool Engine::restore(string_view image) {
+    if (game->station) {
+        return false;
+    }
+    auto readState = [&](string_view bytes, GameState& state) {
+        SnapshotReader reader(bytes.data(), bytes.size());
+        state.visit(reader);
+        return reader.complete() && playable(state);
+    };
+    auto validImage = [&](string_view bytes) {
+        GameState scratch = *game;
+        return readState(bytes, scratch);
+    };
+
+    string_view stateImage;
+    int64_t turns;
+    GameState state = *game;
+    if (!getBytes(image, stateImage) || !readState(stateImage, state) || !getValue(image, turns) ||
+        !game->history.load(image, validImage)) {
+        return false;
+    }
+    static_cast<GameState&>(*game) = move(state);
+    game->turns = turns;
+    game->out.clear();
+    game->arena.reset();
+    return true;
+}
+
+void Engine::setText(bool enabled) {
+    game->out.setTextEnabled(enabled);
+}
+
+MemoryUsage Engine::memoryUsage() const {
+    return game->memoryUsage();
+}
+
+
+// The inside of a JSON string literal, escaping only what JSON requires
+static void writeJsonChars(OutputFrame& out, string_view text) {
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+        unsigned char c = text[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        out << text.substr(start, i - start);
+        if (c == '"') out << "\\\"";
+        else if (c == '\\') out << "\\\\";
+        else if (c == '\n') out << "\\n";
+        else if (c == '\t') out << "\\t";
+        else {
+            char escape[8];
+            int length = snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out << string_view(escape, length);
+        }
+        start = i + 1;
+    }
+    out << text.substr(start);
+}
+
+static void writeJsonString(OutputFrame& out, string_view text) {
+    out << "\"";
+    writeJsonChars(out, text);
+    out << "\"";
+}
+
+// Nanoseconds as microseconds with three decimals
+static void writeMicroseconds(OutputFrame& out, uint64_t nanoseconds) {
+    char text[32];
+    int length = snprintf(text, sizeof(text), "%llu.%03llu", (unsigned long long)(nanoseconds / 1000),
+                          (unsigned long long)(nanoseconds % 1000));
+    out << string_view(text, length);
+}
+
+static string_view trimmed(string_view text) {
+    while (!text.empty() && isspace((unsigned char)text.front())) text.remove_prefix(1);
+    while (!text.empty() && isspace((unsigned char)text.back())) text.remove_suffix(1);
+    return text;
+}
+
+static const char* promptKindName(PromptKind kind) {
+    switch (kind) {
+        case PromptKind::Command:
+            return "command";
+        case PromptKind::Choice:
+            return "choice";
+        case PromptKind::Code:
+            return "code";
+        default:
+            return "enter";
+    }
+}
+
+void writeJsonLines(OutputFrame& out, const StepResult& result) {
+    const Event* event = result.begin();
+    while (event != result.end()) {
+        switch (event->type) {
+            case EventType::Text:
+                out << "{\"type\":\"text\",\"text\":\"";
+                for (; event != result.end() && event->type == EventType::Text; event++) {
+                    writeJsonChars(out, event->text);
+                }
+                out << "\"}\n";
+                continue;
+            case EventType::ItemsListed:
+                out << "{\"type\":\"items_listed\",\"where\":";
+                writeJsonString(out, event->text);
+                out << ",\"items\":[";
+                for (event++; event != result.end() && event->type == EventType::ListedItem; event++) {
+                    if (event[-1].type == EventType::ListedItem) out << ",";
+                    writeJsonString(out, event->text);
+                }
+                out << "]}\n";
+                continue;
+            case EventType::Clear:
+                out << "{\"type\":\"clear\"}\n";
+                break;
+            case EventType::Terminal:
+                out << "{\"type\":\"terminal\",\"text\":";
+                writeJsonString(out, event->text);
+                out << "}\n";
+                break;
+            case EventType::RoomEntered:
+                out << "{\"type\":\"room_entered\",\"room\":";
+                writeJsonString(out, event->text);
+                out << "}\n";
+                break;
+            case EventType::ItemTaken:
+                out << "{\"type\":\"item_taken\",\"item\":";
+                writeJsonString(out, event->text);
+                out << "}\n";
+                break;
+            case EventType::Alert:
+                out << "{\"type\":\"alert\",\"text\":";
+                writeJsonString(out, trimmed(event->text));
+                out << "}\n";
+                break;
+            case EventType::GameOver:
+                out << "{\"type\":\"game_over\",\"result\":";
+                if (event->text == "won") {
+                    out << "\"won\"}\n";
+                } else {
+                    out << "\"died\",\"cause\":";
+                    writeJsonString(out, event->text);
+                    out << "}\n";
+                }
+                break;
+            case EventType::Pause:
+            case EventType::ListedItem:  // Only meaningful after ItemsListed
+                break;
+        }
+        event++;
+    }
+
+    if (result.status == GameStatus::Running) {
+        out << "{\"type\":\"prompt\",\"kind\":\"" << promptKindName(result.prompt.kind) << "\"";
+        if (result.prompt.kind == PromptKind::Choice) {
+            out << ",\"options\":" << result.prompt.options;
+        }
+        out << "}\n";
+    }
+}
+
+void writeChromeTrace(OutputFrame& out) {
+    TraceRegistry& registry = traceRegistry();
+    vector<TraceBuffer*> buffers;
+    {
+        lock_guard<mutex> hold(registry.lock);
+        for (const unique_ptr<TraceBuffer>& buffer : registry.buffers) buffers.push_back(buffer.get());
+    }
+
+    long long pid = getpid();
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (TraceBuffer* buffer : buffers) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->thread
+            << ",\"args\":{\"name\":\"thread " << buffer->thread << "\"}}";
+        buffer->visit(buffer->head.load(memory_order_acquire), [&](const char* name, uint64_t start, uint64_t duration) {
+            // Chrome wants microseconds; keep the nanoseconds as decimals
+            out << ",\n{\"name\":";
+            writeJsonString(out, name);
+            out << ",\"ph\":\"X\",\"ts\":";
+            writeMicroseconds(out, start);
+            out << ",\"dur\":";
+            writeMicroseconds(out, duration);
+            out << ",\"pid\":" << pid << ",\"tid\":" << buffer->thread << "}";
+        });
+    }
+    out << "\n]}\n";
+}
+
+
+// Phases that every command passes through; the rest name its handler
+static bool isRoutingPhase(const char* name) {
+    static const char* const ROUTING[] = {
+        "parseCommand", "dispatchCommand", "answerPrompt", "wrapText", "history.begin", "history.commit"
+    };
+    for (const char* routing : ROUTING) {
+        if (strcmp(name, routing) == 0) return true;
+    }
+    return false;
+}
+
+static void writeSlowCommand(OutputFrame& out, const SlowCommand& command) {
+    out << "{\"session\":" << (size_t)command.session << ",\"turn\":" << command.turn << ",\"input\":";
+    writeJsonString(out, command.input);
+    out << ",\"verb\":\"" << command.verb << "\"";
+    if (command.prompt) {
+        out << ",\"prompt\":\"" << command.prompt << "\"";
+    }
+
+    // The handlers entered, outermost first, e.g. "useItem>useSelected"
+    out << ",\"handler\":\"";
+    bool any = false;
+    for (const PhaseTime& phase : command.profile) {
+        if (isRoutingPhase(phase.name)) continue;
+        if (any) out << ">";
+        writeJsonChars(out, phase.name);
+        any = true;
+    }
+    if (!any) {
+        out << (strcmp(command.verb, "undo") == 0 ? "undoCommand" : command.prompt ? "answerPrompt" : "dispatchCommand");
+    }
+
+    out << "\",\"state\":{\"room\":" << command.state.room << ",\"flags\":[";
+    any = false;
+    for (size_t i = 0; i < sizeof(STATE_FLAGS) / sizeof(STATE_FLAGS[0]); i++) {
+        if (!(command.state.flags >> i & 1)) continue;
+        out << (any ? ",\"" : "\"") << STATE_FLAGS[i].name << "\"";
+        any = true;
+    }
+    out << "],\"inventory\":[";
+    for (int i = 0; i < command.state.inventoryCount; i++) {
+        if (i > 0) out << ",";
+        out << (int)command.state.inventory[i];
+    }
+    out << "]},\"us\":";
+    writeMicroseconds(out, command.duration);
+
+    out << ",\"phases\":{";
+    any = false;
+    for (const PhaseTime& phase : command.profile) {
+        out << (any ? ",\"" : "\"");
+        writeJsonChars(out, phase.name);
+        out << "\":{\"us\":";
+        writeMicroseconds(out, phase.duration);
+        out << ",\"calls\":" << phase.calls << "}";
+        any = true;
+    }
+    out << "},\"output_bytes\":" << command.outputBytes << ",\"events\":" << command.events << "}\n";
+}
+
+SlowLog::SlowLog(int descriptor, uint64_t thresholdUs)
+    : fd(descriptor), thresholdNs(thresholdUs * 1000), writer(&SlowLog::run, this) {
+}
+
+SlowLog::~SlowLog() {
+    {
+        lock_guard<mutex> hold(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+void SlowLog::submit(SlowCommand&& command) {
+    {
+        lock_guard<mutex> hold(lock);
+        if (queue.size() >= MAX_QUEUED) {
+            droppedCount++;
+            return;
+        }
+        queue.push_back(move(command));
+    }
+    wake.notify_one();
+}
+
+size_t SlowLog::dropped() const {
+    lock_guard<mutex> hold(lock);
+    return droppedCount;
+}
+
+// The writer thread: take everything queued, write it without the lock held
+void SlowLog::run() {
+    OutputFrame file(fd);
+    vector<SlowCommand> batch;
+    unique_lock<mutex> hold(lock);
+    while (true) {
+        wake.wait(hold, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            break;  // Stopping, and nothing is left to write
+        }
+        batch.swap(queue);
+        hold.unlock();
+        for (const SlowCommand& command : batch) {
+            writeSlowCommand(file, command);
+        }
+        file.flush();
+        batch.clear();
+        hold.lock();
+    }
+}
+
+
+// Replay files (replay.h)
+static const uint8_t REPLAY_VERSION = 2;
+static const uint64_t REPLAY_CHECKPOINT = 0;
+static const uint64_t REPLAY_INDEX = 1;
+static const uint64_t REPLAY_INPUT = 2;  // Plus the command ID
+static const size_t REPLAY_TRAILER = 12;  // u64 index offset, "STRX"
+
+static void putVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+static bool getVarint(string_view bytes, size_t& offset, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && offset < bytes.size(); shift += 7) {
+        uint8_t byte = bytes[offset++];
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+static uint64_t clockMs() {
+    return traceClock() / 1000000;
+}
+
+ReplayWriter::ReplayWriter(int descriptor, uint64_t seed, const EngineConfig& config) : fd(descriptor) {
+    startMs = lastMs = clockMs();
+    buffer = "STRP";
+    buffer += (char)REPLAY_VERSION;
+    putVarint(buffer, seed);
+    putVarint(buffer, (uint64_t)config.oxygenCommands);
+    putVarint(buffer, (uint64_t)config.undoDepth);
+    buffer += (char)config.showIntro;
+}
+
+ReplayWriter::~ReplayWriter() {
+    finish();
+}
+
+void ReplayWriter::record(const Engine& engine, string_view input) {
+    if (finished) return;
+    if (turn > 0 && turn % CHECKPOINT_TURNS == 0) {
+        checkpoints.push_back({ turn, written + buffer.size() });
+        string image = engine.snapshot();
+        putVarint(buffer, REPLAY_CHECKPOINT);
+        putVarint(buffer, turn);
+        putVarint(buffer, lastMs - startMs);
+        putVarint(buffer, image.size());
+        buffer += image;
+        commands.clear();  // A new segment numbers its commands afresh
+    }
+
+    uint64_t now = clockMs();
+    size_t id = find(commands.begin(), commands.end(), input) - commands.begin();
+    putVarint(buffer, REPLAY_INPUT + id);
+    putVarint(buffer, now - lastMs);
+    if (id == commands.size()) {
+        putVarint(buffer, input.size());
+        buffer += input;
+        commands.push_back(string(input));
+    }
+    lastMs = now;
+    turn++;
+    if (buffer.size() >= FLUSH_BYTES) flush();
+}
+
+bool ReplayWriter::finish() {
+    if (finished) return !failed;
+    finished = true;
+    uint64_t offset = written + buffer.size();
+    putVarint(buffer, REPLAY_INDEX);
+    putVarint(buffer, turn);
+    putVarint(buffer, lastMs - startMs);
+    putVarint(buffer, checkpoints.size());
+    for (const pair<long, uint64_t>& checkpoint : checkpoints) {
+        putVarint(buffer, checkpoint.first);
+        putVarint(buffer, checkpoint.second);
+    }
+    putValue(buffer, offset);
+    buffer += "STRX";
+    flush();
+    return !failed;
+}
+
+void ReplayWriter::flush() {
+    size_t done = 0;
+    while (!failed && done < buffer.size()) {
+        ssize_t count = write(fd, buffer.data() + done, buffer.size() - done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) failed = true;
+        else done += count;
+    }
+    written += buffer.size();  // Offsets stay right even if the file is lost
+    buffer.clear();
+}
+
+ReplayPlayer::ReplayPlayer(string file) : bytes(move(file)) {
+    string_view view(bytes);
+    size_t offset = 5;
+    uint64_t seed, oxygen, undoDepth;
+    if (view.size() < 5 || view.substr(0, 4) != "STRP" || (uint8_t)view[4] != REPLAY_VERSION ||
+        !getVarint(view, offset, seed) || !getVarint(view, offset, oxygen) || !getVarint(view, offset, undoDepth) ||
+        offset >= view.size()) {
+        return;
+    }
+    gameSeed = seed;
+    gameConfig.oxygenCommands = (int)oxygen;
+    gameConfig.undoDepth = (int)undoDepth;
+    gameConfig.showIntro = view[offset++] != 0;
+    gameConfig.text = false;  // Play at memory speed; see Engine::setText
+    recordsStart = offset;
+    if (!readIndex()) {
+        scan();
+    }
+    rewind();
+}
+
+// The index the trailer points to, if the file was finished
+bool ReplayPlayer::readIndex() {
+    string_view view(bytes);
+    uint64_t indexOffset;
+    string_view trailer = view.substr(view.size() - min(view.size(), REPLAY_TRAILER));
+    if (trailer.size() < REPLAY_TRAILER || trailer.substr(8) != "STRX" || !getValue(trailer, indexOffset) ||
+        indexOffset < recordsStart || indexOffset > view.size() - REPLAY_TRAILER) {
+        return false;
+    }
+    size_t offset = indexOffset;
+    uint64_t code, turns, ms, count;
+    if (!getVarint(view, offset, code) || code != REPLAY_INDEX || !getVarint(view, offset, turns) ||
+        !getVarint(view, offset, ms) || !getVarint(view, offset, count) || count > view.size()) {
+        return false;
+    }
+    index.clear();
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t turn, at;
+        if (!getVarint(view, offset, turn) || !getVarint(view, offset, at) || turn > turns || at < recordsStart ||
+            at >= indexOffset || (!index.empty() && turn <= (uint64_t)index.back().first)) {
+            return false;
+        }
+        index.push_back({ (long)turn, (size_t)at });
+    }
+    turnCount = turns;
+    recordedMs = ms;
+    recordsEnd = indexOffset;
+    return true;
+}
+
+// Rebuild the index of a file cut off before it, up to the last whole record
+void ReplayPlayer::scan() {
+    index.clear();
+    commands.clear();
+    turnCount = 0;
+    recordedMs = 0;
+    recordsEnd = bytes.size();
+    size_t offset = recordsStart;
+    Record record;
+    while (true) {
+        size_t start = offset;
+        if (!readRecord(offset, record)) {
+            recordsEnd = start;
+            break;
+        }
+        if (record.checkpoint) {
+            if (record.turn != turnCount) {
+                recordsEnd = start;
+                break;
+            }
+            index.push_back({ record.turn, start });
+        } else {
+            turnCount++;
+            recordedMs += record.delayMs;
+        }
+    }
+    commands.clear();
+}
+
+// Decode the record at offset and move past it. Keeps the segment's
+// command IDs in 'commands'. False at the index or anything unreadable.
+bool ReplayPlayer::readRecord(size_t& offset, Record& record) {
+    string_view view = string_view(bytes).substr(0, recordsEnd);
+    uint64_t code;
+    if (!getVarint(view, offset, code) || code == REPLAY_INDEX) {
+        return false;
+    }
+    if (code == REPLAY_CHECKPOINT) {
+        uint64_t turn, length;
+        if (!getVarint(view, offset, turn) || !getVarint(view, offset, record.ms) || !getVarint(view, offset, length) ||
+            length > view.size() - offset) {
+            return false;
+        }
+        record.checkpoint = true;
+        record.turn = turn;
+        record.image = view.substr(offset, length);
+        offset += length;
+        commands.clear();
+        return true;
+    }
+
+    uint64_t id = code - REPLAY_INPUT;
+    if (!getVarint(view, offset, record.delayMs) || id > commands.size()) {
+        return false;
+    }
+    if (id == commands.size()) {
+        uint64_t length;
+        if (!getVarint(view, offset, length) || length > view.size() - offset) {
+            return false;
+        }
+        commands.push_back(view.substr(offset, length));
+        offset += length;
+    }
+    record.checkpoint = false;
+    record.input = commands[id];
+    return true;
+}
+
+void ReplayPlayer::rewind() {
+    engine = Engine::create(gameSeed, gameConfig);
+    last = engine->result();
+    next = recordsStart;
+    position = 0;
+    elapsedMs = 0;
+    lastInput = string_view();
+    commands.clear();
+}
+
+bool ReplayPlayer::seek(long turn, long* played) {
+    if (!engine || turn < 0 || turn > turnCount) {
+        return false;
+    }
+    // The last checkpoint at or before the turn, if it beats playing on
+    auto checkpoint = upper_bound(index.begin(), index.end(), make_pair(turn, (size_t)-1));
+    bool restored = false;
+    if (checkpoint != index.begin() && (turn < position || checkpoint[-1].first > position)) {
+        size_t offset = checkpoint[-1].second;
+        Record record;
+        if (readRecord(offset, record) && record.checkpoint && record.turn == checkpoint[-1].first &&
+            engine->restore(record.image)) {
+            last = engine->result();
+            next = offset;
+            position = record.turn;
+            elapsedMs = record.ms;
+            lastInput = string_view();
+            restored = true;
+        }
+    }
+    if (!restored && turn < position) {
+        rewind();
+    }
+
+    long steps = 0;
+    while (position < turn) {
+        if (!step()) return false;
+        steps++;
+    }
+    if (played) *played = steps;
+    return true;
+}
+
+bool ReplayPlayer::step() {
+    Record record;
+    size_t offset = next;
+    do {
+        if (!engine || !readRecord(offset, record)) return false;
+    } while (record.checkpoint);
+    next = offset;
+    last = engine->step(record.input);
+    position++;
+    elapsedMs += record.delayMs;
+    lastInput = record.input;
+    return true;
+}
@@ -0,0 +1,586 @@
+// Public interface of the station engine (libstation). The engine plays the
+// game one step at a time and never touches stdin, stdout or the clock: each
+// step returns typed output events, where the session stands and what kind of
+// input the next step expects. Front ends (the terminal game, servers, bots,
+// benchmarks) decide how to render the events and where input comes from.
+#ifndef STATION_H
+#define STATION_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>   // For unique_ptr
+#include <cstdint>  // For uint64_t
+#include <cstring>  // For strlen and memcpy
+#include <cerrno>   // For EINTR and EAGAIN
+#include <cstdio>   // For snprintf
+#include <unistd.h>   // For STDOUT_FILENO
+#include <sys/uio.h>  // For writev function
+#include <poll.h>     // For waiting on a slow output descriptor
+#include "trace.h"
+#include "slab.h"
+
+
+// Where a session stands after a command
+enum class GameStatus {
+    Running,
+    Died,
+    Won,
+    Disconnected  // Player stopped reading output
+};
+
+enum class DeathCause {
+    None,
+    OxygenDepleted,   // Suit leak countdown ran out
+    HelmetRemoved,    // Took the helmet off to eat the Energy Bar
+    SuitSuffocation   // Tried to reseal the helmet after breaking the seal
+};
+
+// Kinds of output a step produces. The first four draw the screen; the
+// rest are typed events for machine clients, which survive a screen clear.
+enum class EventType {
+    Text,         // Display text, already wrapped
+    Clear,        // Clear the screen; what follows is a new screen
+    Terminal,     // Text a computer terminal types out, delayUs per character
+    Pause,        // Dramatic pause of delayUs before any further output
+    RoomEntered,  // text: the room the player is now in
+    ItemsListed,  // text: "room" or "inventory"; a ListedItem per item follows
+    ListedItem,   // text: item name
+    ItemTaken,    // text: item name
+    Alert,        // text: the warning, unwrapped
+    GameOver      // text: "won", or the cause of death
+};
+
+inline bool isDisplayEvent(EventType type) {
+    return type <= EventType::Pause;
+}
+
+struct Event {
+    EventType type;
+    std::string_view text;
+    int delayUs;
+};
+
+// One turn's worth of output, as a list of events. Static text (string
+// literals, room and item text) is referenced in place; only small dynamic
+// fragments such as numbers and player input are copied into scratch blocks
+// owned by the frame. Text goes out with writev() when flushed, so the same
+// kilobytes of room text are never copied into a buffer just to be written.
+//
+// A frame is bounded. On a non-blocking descriptor a flush writes what the
+// reader will take and leaves the rest pending; past HIGH_WATER of pending
+// text, or of scratch space (only recycled once everything is out), callers
+// should stop producing (see renderTurn in StationCLIgame.cpp). Reaching
+// CAPACITY forces a drain, and a reader that takes nothing for the stall
+// timeout is cut off: the frame marks itself stalled and drops all further
+// output. A stall timeout of 0 never waits: a writer that must not block
+// (the HTTP server) loses the reader instead.
+class OutputFrame {
+    public:
+        static const int BLOCK_SIZE = 4096;          // Scratch block for dynamic fragments
+        static const int MAX_IOV = 1024;             // Segments per writev call (IOV_MAX)
+        static const size_t HIGH_WATER = 64 * 1024;  // Pending or scratch bytes before backpressure
+        static const size_t CAPACITY = 256 * 1024;   // Pending bytes never exceed this
+
+        // flush() writes to 'descriptor'. The default, -1, is for frames
+        // that only collect events, like the engine's own: a flush drops them.
+        explicit OutputFrame(int descriptor = -1, int stallTimeoutMs = 30000) {
+            fd = descriptor;
+            stallTimeout = stallTimeoutMs;
+            blockUsed = 0;
+            kept = 0;
+            pending = 0;
+            stalled = false;
+            textEnabled = true;
+            oversizedBytes = 0;
+        }
+
+        ~OutputFrame() {
+            for (char* block : blocks) Slab::release(block, BLOCK_SIZE);
+            for (char* block : oversized) delete[] block;
+        }
+
+        // Reference text that outlives the frame (literals, room/item data)
+        void ref(const char* text, size_t length) {
+            if (length == 0 || !textEnabled || !makeRoom(length)) return;
+            events.push_back({ EventType::Text, std::string_view(text, length), 0 });
+            pending += length;
+        }
+
+        void ref(const char* text) {
+            ref(text, strlen(text));
+        }
+
+        void ref(std::string_view text) {
+            ref(text.data(), text.size());
+        }
+
+        // Add a non-text event. Its text, if any, must outlive the frame.
+        void event(EventType type, std::string_view text = std::string_view(), int delayUs = 0) {
+            if (stalled || (!textEnabled && type != EventType::Terminal && isDisplayEvent(type))) return;
+            events.push_back({ type, text, delayUs });
+        }
+
+        // Add a typed event whose text is transient, e.g. an item name
+        // that may move before the frame is written
+        void report(EventType type, std::string_view text) {
+            if (stalled) return;
+            events.push_back({ type, std::string_view(store(text.data(), text.size()), text.size()), 0 });
+        }
+
+        // Copy a transient fragment into scratch space
+        const char* copy(const char* text, size_t length) {
+            if (length == 0 || !textEnabled || !makeRoom(length)) return text;
+            char* dest = reserve(length);
+            memcpy(dest, text, length);
+            append(dest, length);
+            return dest;
+        }
+
+        // Keep a NUL-terminated copy alive until the frame is flushed
+        const char* store(const char* text, size_t length) {
+            char* dest = reserve(length + 1);
+            memcpy(dest, text, length);
+            dest[length] = '\0';
+            return dest;
+        }
+
+        OutputFrame& operator<<(const char* text) {
+            ref(text);
+            return *this;
+        }
+
+        OutputFrame& operator<<(std::string_view text) {
+            copy(text.data(), text.size());
+            return *this;
+        }
+
+        OutputFrame& operator<<(char c) {
+            copy(&c, 1);
+            return *this;
+        }
+
+        OutputFrame& operator<<(long long number) {
+            char digits[24];
+            int length = snprintf(digits, sizeof(digits), "%lld", number);
+            copy(digits, length);
+            return *this;
+        }
+
+        OutputFrame& operator<<(int number) {
+            return *this << (long long)number;
+        }
+
+        OutputFrame& operator<<(size_t number) {
+            return *this << (long long)number;
+        }
+
+        // Drop the screen not yet written; it would be cleared anyway.
+        // Typed events and output protected by keepPending() survive.
+        void discard() {
+            size_t end = kept;
+            for (size_t i = kept; i < events.size(); i++) {
+                if (isDisplayEvent(events[i].type)) {
+                    if (events[i].type == EventType::Text) pending -= events[i].text.size();
+                } else {
+                    events[end++] = events[i];
+                }
+            }
+            if (end == 0) {
+                reset();
+                return;
+            }
+            events.resize(end);
+        }
+
+        // Drop everything, kept output included
+        void clear() {
+            reset();
+        }
+
+        // Protect what is pending from discard() until the next flush, so
+        // several commands can share one frame
+        void keepPending() {
+            kept = events.size();
+        }
+
+        bool hasKept() const {
+            return kept > 0;
+        }
+
+        const Event* data() const {
+            return events.data();
+        }
+
+        size_t size() const {
+            return events.size();
+        }
+
+        size_t pendingBytes() const {
+            return pending;
+        }
+
+        bool overHighWater() const {
+            return pending >= HIGH_WATER || blockUsed >= HIGH_WATER;
+        }
+
+        // Machine clients that only read typed events can turn display
+        // output off; Terminal events are kept either way
+        void setTextEnabled(bool enabled) {
+            textEnabled = enabled;
+        }
+
+        bool wantsText() const {
+            return textEnabled;
+        }
+
+        // The reader stopped taking output; nothing more will be sent
+        bool isStalled() const {
+            return stalled;
+        }
+
+        // Heap bytes held by the frame, whether or not they are in use
+        size_t heapBytes() const {
+            return Slab::blockBytes(events.capacity() * sizeof(Event)) + Slab::blockBytes(iov.capacity() * sizeof(iovec)) +
+                   Slab::blockBytes(blocks.capacity() * sizeof(char*)) + blocks.size() * Slab::blockBytes(BLOCK_SIZE) +
+                   oversized.capacity() * sizeof(char*) + oversizedBytes;
+        }
+
+        // Write the frame's text as far as the descriptor takes it right now,
+        // with as few syscalls as possible; other events are skipped. The
+        // frame is recycled once all of it is out; a would-block leaves the
+        // unwritten tail pending.
+        void flush() {
+            TraceScope trace("flush");
+            size_t next = 0;
+            while (next < events.size()) {
+                size_t last = gather(next);
+                if (iov.empty()) break;
+                ssize_t written = writev(fd, iov.data(), iov.size());
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        events.erase(events.begin(), events.begin() + next);
+                        kept = kept > next ? kept - next : 0;
+                        return;
+                    }
+                    break;  // Nowhere left to write; drop the frame
+                }
+                next = consume(next, last, written);
+            }
+            reset();
+        }
+
+        // For writers that send asynchronously (io_uring): the pending text
+        // as a gather list. It stays valid until sent() as long as nothing
+        // is added to the frame meanwhile.
+        const std::vector<iovec, SlabAllocator<iovec>>& pendingText() {
+            gather(0);
+            return iov;
+        }
+
+        // 'bytes' from the front of pendingText() went out
+        void sent(size_t bytes) {
+            size_t next = consume(0, events.size(), bytes);
+            if (pending == 0) {
+                reset();
+                return;
+            }
+            events.erase(events.begin(), events.begin() + next);
+            kept = kept > next ? kept - next : 0;
+        }
+
+        // Flush until at most 'target' bytes are pending, waiting for the
+        // reader as needed. Returns false, and stalls the frame, if the
+        // reader takes nothing for the stall timeout.
+        bool drain(size_t target = 0) {
+            flush();
+            while (pending > target && !stalled) {
+                pollfd writable = { fd, POLLOUT, 0 };
+                int ready = poll(&writable, 1, stallTimeout);
+                if (ready < 0 && errno == EINTR) continue;
+                if (ready <= 0) {
+                    stalled = true;
+                    reset();
+                    break;
+                }
+                flush();
+            }
+            return !stalled;
+        }
+
+    private:
+        std::vector<Event, SlabAllocator<Event>> events;
+        std::vector<iovec, SlabAllocator<iovec>> iov;     // Reused gather list for writev
+        std::vector<char*, SlabAllocator<char*>> blocks;  // Scratch blocks, kept across turns
+        std::vector<char*> oversized;  // Fragments larger than a block, freed on reset
+        size_t blockUsed;
+        size_t kept;              // Events discard() leaves alone
+        size_t pending;           // Bytes of text in events
+        size_t oversizedBytes;
+        int fd;
+        int stallTimeout;         // Milliseconds a reader may take nothing
+        bool stalled;
+        bool textEnabled;
+
+        // Fill iov with the text of up to MAX_IOV events from 'next';
+        // returns the index after the last event looked at
+        size_t gather(size_t next) {
+            iov.clear();
+            size_t last = next;
+            for (; last < events.size() && iov.size() < (size_t)MAX_IOV; last++) {
+                if (events[last].type != EventType::Text) continue;
+                iovec segment;
+                segment.iov_base = const_cast<char*>(events[last].text.data());
+                segment.iov_len = events[last].text.size();
+                iov.push_back(segment);
+            }
+            return last;
+        }
+
+        // Account for 'written' bytes from event 'next' on: skip fully
+        // written events and trim a partially written one. Returns the
+        // first event with text left.
+        size_t consume(size_t next, size_t last, size_t written) {
+            pending -= written;
+            while (next < last) {
+                Event& current = events[next];
+                if (current.type != EventType::Text || written >= current.text.size()) {
+                    if (current.type == EventType::Text) written -= current.text.size();
+                    next++;
+                } else {
+                    current.text.remove_prefix(written);
+                    break;
+                }
+            }
+            return next;
+        }
+
+        // Keep the frame within CAPACITY; false once output is being dropped
+        bool makeRoom(size_t length) {
+            if (stalled) return false;
+            if (pending + length > CAPACITY) drain(CAPACITY > length ? CAPACITY - length : 0);
+            if (blockUsed + length > CAPACITY) drain();  // Recycle scratch blocks
+            return !stalled;
+        }
+
+        char* reserve(size_t length) {
+            if (length > BLOCK_SIZE) {
+                oversized.push_back(new char[length]);
+                oversizedBytes += length;
+                return oversized.back();
+            }
+            size_t current = blockUsed / BLOCK_SIZE;
+            size_t offset = blockUsed % BLOCK_SIZE;
+            if (blockUsed == 0 || offset + length > BLOCK_SIZE) {
+                if (blockUsed != 0) current++;
+                offset = 0;
+            }
+            if (current == blocks.size()) blocks.push_back(static_cast<char*>(Slab::allocate(BLOCK_SIZE)));
+            blockUsed = current * BLOCK_SIZE + offset + length;
+            return blocks[current] + offset;
+        }
+
+        // Add a copied fragment, merging it with the previous one when adjacent
+        void append(char* text, size_t length) {
+            if (!events.empty()) {
+                Event& last = events.back();
+                if (last.type == EventType::Text && last.text.data() + last.text.size() == text) {
+                    last.text = std::string_view(last.text.data(), last.text.size() + length);
+                    pending += length;
+                    return;
+                }
+            }
+            ref(text, length);
+        }
+
+        void reset() {
+            events.clear();
+            kept = 0;
+            pending = 0;
+            for (char* block : oversized) delete[] block;
+            oversized.clear();
+            oversizedBytes = 0;
+            blockUsed = 0;
+        }
+};
+
+// Heap bytes attributed to one game, by what owns them
+struct MemoryUsage {
+    size_t objects = 0;      // The Engine and Game objects themselves
+    size_t rooms = 0;        // Room table; names and descriptions are literals
+    size_t roomItems = 0;    // Room item lists that outgrew their inline space
+    size_t inventory = 0;    // The inventory, likewise
+    size_t visitFlags = 0;   // roomFirstVisit and roomSearched
+    size_t output = 0;       // Output frame buffers
+    size_t parser = 0;       // Turn arena
+    size_t history = 0;      // Undo snapshots
+
+    size_t total() const {
+        return objects + rooms + roomItems + inventory + visitFlags + output + parser + history;
+    }
+
+    void report(OutputFrame& out) const {
+        out << "    objects      " << objects << "\n";
+        out << "    rooms        " << rooms << "\n";
+        out << "    room items   " << roomItems << "\n";
+        out << "    inventory    " << inventory << "\n";
+        out << "    visit flags  " << visitFlags << "\n";
+        out << "    output       " << output << "\n";
+        out << "    parser       " << parser << "\n";
+        out << "    history      " << history << "\n";
+    }
+};
+
+// Distribution of MemoryUsage across many sessions: totals per category
+// and a power-of-two histogram of session sizes
+class MemoryHistogram {
+    public:
+        static const int BUCKETS = 32;  // Bucket i holds sizes in [2^i, 2^(i+1))
+
+        void add(const MemoryUsage& usage) {
+            size_t total = usage.total();
+            int bucket = 0;
+            while (bucket < BUCKETS - 1 && (size_t(2) << bucket) <= total) bucket++;
+            counts[bucket]++;
+            sessions++;
+            sum.objects += usage.objects;
+            sum.rooms += usage.rooms;
+            sum.roomItems += usage.roomItems;
+            sum.inventory += usage.inventory;
+            sum.visitFlags += usage.visitFlags;
+            sum.output += usage.output;
+            sum.parser += usage.parser;
+            sum.history += usage.history;
+            if (sessions == 1 || total < smallest) smallest = total;
+            if (total > largest) largest = total;
+        }
+
+        void report(OutputFrame& out) const {
+            out << "Sessions: " << sessions << "\n";
+            if (sessions == 0) return;
+            out << "Total bytes: " << sum.total() << " (mean " << sum.total() / sessions
+                << ", min " << smallest << ", max " << largest << ")\n";
+            sum.report(out);
+            out << "Session size histogram (bytes):\n";
+            for (int i = 0; i < BUCKETS; i++) {
+                if (counts[i] == 0) continue;
+                out << "    [" << (size_t(1) << i) << ", " << (size_t(2) << i) << ")  " << counts[i] << "\n";
+            }
+        }
+
+    private:
+        MemoryUsage sum;
+        size_t counts[BUCKETS] = {};
+        size_t sessions = 0;
+        size_t smallest = 0;
+        size_t largest = 0;
+};
+
+// What the next step's input is taken as
+enum class PromptKind {
+    Command,  // A game command
+    Choice,   // A number from the menu just shown, 0 to cancel
+    Code,     // Free text such as a door code or password
+    Enter     // Any line; the game is waiting for the player to continue
+};
+
+struct PromptState {
+    PromptKind kind;
+    int options;  // Highest menu number for PromptKind::Choice
+};
+
+class SlowLog;
+class SharedStation;
+
+// A station several engines play in together (EngineConfig::station)
+std::shared_ptr<SharedStation> createSharedStation();
+
+struct EngineConfig {
+    bool showIntro = true;    // Open with the emergency alert and wait for Enter
+    int oxygenCommands = 15;  // Commands the suit leak allows before death
+    bool text = true;         // Produce display text; off leaves only typed events
+    int undoDepth = 64;       // Commands undo and rewind can step back; 0 turns them off
+    SlowLog* slowLog = NULL;  // Where steps over its threshold are reported (slowlog.h)
+    uint64_t sessionId = 0;   // Names this session in the slow-command log
+    std::shared_ptr<SharedStation> station;  // Share rooms' items, doors and systems with its other players; no undo
+};
+
+// Output and state after a step. The events stay valid until the next
+// call to step() or load().
+struct StepResult {
+    const Event* events;
+    size_t eventCount;
+    GameStatus status;
+    PromptState prompt;
+    int undoSteps;  // Commands "undo" can step back; after a death, the way back in
+
+    const Event* begin() const { return events; }
+    const Event* end() const { return events + eventCount; }
+};
+
+class Game;
+
+class Engine {
+    public:
+        static std::unique_ptr<Engine> create(uint64_t seed, const EngineConfig& config = EngineConfig());
+        ~Engine();
+
+        // Start a new game in place, as create() would, keeping the memory
+        // the old one held. Hosts recycle finished sessions this way.
+        void reset(uint64_t seed, const EngineConfig& config = EngineConfig());
+
+        static void* operator new(size_t size) {
+            return Slab::allocate(size);
+        }
+
+        static void operator delete(void* pointer, size_t size) {
+            Slab::release(pointer, size);
+        }
+
+        // Run one line of input: a command, the answer to the pending
+        // prompt, or several of either separated by ';' or newlines
+        StepResult step(std::string_view input);
+
+        // Output of the latest step; after create() or load(), the opening screen
+        StepResult result() const;
+
+        // The whole game state as a string, and back. A failed load leaves
+        // the game as it was; a game in a shared station can't be loaded.
+        std::string save() const;
+        bool load(std::string_view saved);
+
+        // The session as an exact binary image, undo history included, and
+        // back; for replay checkpoints (replay.h). Images only fit the build
+        // that made them. A failed restore leaves the game as it was; a game
+        // in a shared station can't be restored.
+        std::string snapshot() const;
+        bool restore(std::string_view image);
+
+        // Turn display text on or off from the next step (EngineConfig::text)
+        void setText(bool enabled);
+
+        MemoryUsage memoryUsage() const;
+
+    private:
+        Engine(std::unique_ptr<Game> game, const EngineConfig& config);
+        StepResult profiledStep(std::string_view input);
+
+        std::unique_ptr<Game> game;
+        SlowLog* slowLog;
+        uint64_t sessionId;
+};
+
+// Write a step as JSON Lines, one object per event followed by the prompt
+// or the end of the game, e.g.
+//     {"type":"item_taken","item":"Crowbar"}
+//     {"type":"prompt","kind":"command"}
+// Consecutive text events are joined into one "text" line and items that
+// were listed together share one "items_listed" line.
+void writeJsonLines(OutputFrame& out, const StepResult& result);
+
+// Write every thread's recorded trace events (see trace.h) as one Chrome
+// trace JSON document. Safe to call while other threads are tracing.
+void writeChromeTrace(OutputFrame& out);
+
+#endif
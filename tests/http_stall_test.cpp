@@ -0,0 +1,92 @@
+// A client that pipelines requests and reads its answers slowly, then not
+// at all, must not hold up the server's loop: serving and flushing the
+// connection never waits on the socket, and the connection stays open.
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "../http.h"
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// One pass of the loop as StationServer.cpp runs it: read a few more
+// pipelined requests and answer them, then send, answering more while the
+// output goes straight out
+static void turn(HttpConnection& connection, SessionApi& api) {
+    static const string_view REQUEST = "GET /metrics HTTP/1.1\r\nHost: test\r\n\r\n";
+    if (connection.wantsInput()) {
+        size_t available;
+        char* space = connection.readSpace(available);
+        size_t count = min(available / REQUEST.size(), (size_t)16);
+        for (size_t i = 0; i < count; i++) memcpy(space + i * REQUEST.size(), REQUEST.data(), REQUEST.size());
+        connection.received(count * REQUEST.size());
+        connection.serve(api);
+    }
+    connection.out.flush();
+    while (connection.out.pendingBytes() == 0 && connection.hasBuffered() && connection.serve(api)) {
+        connection.out.flush();
+    }
+}
+
+// Run 'rounds' passes, the client reading up to 'readBytes' after each
+static void play(HttpConnection& connection, SessionApi& api, int client, int rounds, size_t readBytes, size_t& received) {
+    char sink[4096];
+    for (int round = 0; round < rounds; round++) {
+        auto start = chrono::steady_clock::now();
+        turn(connection, api);
+        if (chrono::steady_clock::now() - start > chrono::seconds(1)) {
+            expect(false, "a pass waited on the reader");
+            return;
+        }
+        expect(!connection.out.isStalled(), "the connection stays open");
+        expect(connection.out.pendingBytes() <= OutputFrame::CAPACITY, "pending output stays within the frame");
+        for (size_t wanted = readBytes; wanted > 0;) {
+            ssize_t count = read(client, sink, min(wanted, sizeof(sink)));
+            if (count <= 0) break;
+            received += count;
+            wanted -= count;
+        }
+        if (failures) return;
+    }
+}
+
+int main() {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        perror("socketpair");
+        return 2;
+    }
+    int size = 16384;  // Small socket buffers, so output backs up early
+    setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+    setsockopt(sockets[1], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    fcntl(sockets[0], F_SETFL, fcntl(sockets[0], F_GETFL) | O_NONBLOCK);
+    fcntl(sockets[1], F_SETFL, fcntl(sockets[1], F_GETFL) | O_NONBLOCK);
+
+    ShardMetrics metrics[1];
+    StationDirectory stations;
+    SessionApi api(chrono::seconds(60), 0, 0, 1, metrics, &stations);
+    HttpConnection connection(sockets[0]);
+
+    // A slow reader: well past a frame's worth of answers go through
+    size_t received = 0;
+    play(connection, api, sockets[1], 2000, 2048, received);
+    expect(received > 4 * OutputFrame::CAPACITY, "answers keep flowing to a slow reader");
+
+    // A reader that stopped: output backs up, and nothing waits for it
+    play(connection, api, sockets[1], 200, 0, received);
+    expect(connection.out.pendingBytes() > 0, "answers wait for the reader");
+
+    close(sockets[0]);
+    close(sockets[1]);
+    if (failures) return 1;
+    printf("http_stall_test: ok\n");
+    return 0;
+}
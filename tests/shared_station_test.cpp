@@ -0,0 +1,73 @@
+// Two players in one shared station: a take menu answered after the other
+// player has emptied part of the room still means the items it listed, and
+// hints know what the other player has taken, wherever it was.
+#include <cstdio>
+
+#include "../station.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void expect(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// The item a step took, or "" if it took none
+static string_view taken(const StepResult& result) {
+    for (const Event& event : result) {
+        if (event.type == EventType::ItemTaken) return event.text;
+    }
+    return "";
+}
+
+// Whether a step's display text, pieces joined, contains 'text'
+static bool says(const StepResult& result, string_view text) {
+    string shown;
+    for (const Event& event : result) {
+        if (event.type == EventType::Text) shown += event.text;
+    }
+    return shown.find(text) != string::npos;
+}
+
+int main() {
+    EngineConfig config;
+    config.showIntro = false;
+    config.station = createSharedStation();
+    unique_ptr<Engine> a = Engine::create(1, config);
+    unique_ptr<Engine> b = Engine::create(2, config);
+    a->step("use headlight");
+    b->step("use headlight");
+
+    // A lists Crowbar, Duct Tape, Pressure Gauge; B takes the Crowbar
+    // before A answers, so the Duct Tape moves up to first in the room
+    StepResult menu = a->step("take");
+    expect(menu.prompt.kind == PromptKind::Choice && menu.prompt.options == 3, "take lists the airlock's three items");
+    expect(taken(b->step("take crowbar")) == "Crowbar", "B takes the Crowbar");
+    expect(taken(a->step("2")) == "Duct Tape", "A's answer takes the item its menu listed");
+
+    // B puts the Crowbar back, A lists it, B takes it again before A answers
+    b->step("drop crowbar");
+    menu = a->step("take");
+    expect(menu.prompt.options == 2, "take lists the Pressure Gauge and the Crowbar");
+    expect(taken(b->step("take crowbar")) == "Crowbar", "B takes the Crowbar again");
+    StepResult answer = a->step("2");
+    expect(taken(answer) == "", "A's answer takes nothing");
+    expect(says(answer, "The Crowbar isn't there anymore."), "A is told the Crowbar is gone");
+
+    // B opens the airlock and takes the Sticky Note from the corridor. A,
+    // still in the airlock, can't get past the Observation Deck without it,
+    // and a shared game has no undo to suggest.
+    for (const char* command : { "use crowbar", "move", "search" }) b->step(command);
+    expect(taken(b->step("take sticky note")) == "Sticky Note", "B takes the Sticky Note");
+    StepResult hint = a->step("hint");
+    expect(says(hint, "There's no way forward from here."), "A's hint knows the Sticky Note is gone");
+    expect(!says(hint, "undo"), "A's hint doesn't offer undo");
+
+    if (failures) return 1;
+    printf("shared_station_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Generates hint_table.h: for every state of the hint model (hints.h) in
+// which each key item is held or still in its starting room, the fewest
+// commands left to win. Steps are relaxed over the whole table until no
+// distance improves, which takes as many passes as the longest plan.
+//
+//     ./hint_table_gen > hint_table.h
+#include <cstdio>
+#include <vector>
+
+#include "../hints.h"
+
+using namespace std;
+
+int main() {
+    vector<int> distance(HINT_TABLE_SIZE, HINT_UNREACHABLE);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int index = 0; index < HINT_TABLE_SIZE; index++) {
+            HintState state = HintState::fromIndex(index);
+            state.settle();
+            for (int step = 0; step < (int)HintStep::Count; step++) {
+                HintState next;
+                if (!applyHintStep((HintStep)step, state, next)) continue;
+                int rest = (HintStep)step == HintStep::RepairComputer ? 0 : distance[next.tableIndex()];
+                int total = HINT_STEPS[step].commands + rest;
+                if (total < distance[index]) {
+                    distance[index] = total;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    printf("// Generated by tools/hint_table.cpp from hints.h; do not edit.\n");
+    printf("// Commands left to win from each HintState::tableIndex(), or\n");
+    printf("// HINT_UNREACHABLE.\n");
+    printf("#ifndef STATION_HINT_TABLE_H\n");
+    printf("#define STATION_HINT_TABLE_H\n\n");
+    printf("#include \"hints.h\"\n\n");
+    printf("constexpr uint8_t HINT_DISTANCE[HINT_TABLE_SIZE] = {");
+    for (int index = 0; index < HINT_TABLE_SIZE; index++) {
+        printf("%s%d,", index % 32 ? "" : "\n    ", distance[index]);
+    }
+    printf("\n};\n\n#endif\n");
+    return 0;
+}
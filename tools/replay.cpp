@@ -0,0 +1,166 @@
+// Replay viewer: plays a file recorded with --record (see replay.h) back
+// through the engine with display text off, then shows what the player saw
+// at the turn asked for. A support report like "I died in the mess hall and
+// don't know why" comes down to ./replay game.rpl, which shows the final
+// screen and the inputs that led there.
+//
+//     ./replay FILE               summary, the last inputs and the final screen
+//     ./replay FILE --turn=N      the screen after input N and the state then
+//     ./replay FILE --bench       time a full playback and seeks to every turn
+//
+// --json prints screens as JSON Lines, as the game's --json mode does.
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+#include "../replay.h"
+
+using namespace std;
+
+static void printScreen(const StepResult& result, bool json) {
+    OutputFrame out(STDOUT_FILENO);
+    if (json) {
+        writeJsonLines(out, result);
+    } else {
+        for (const Event& event : result) {
+            if (event.type == EventType::Text || event.type == EventType::Terminal) {
+                out.ref(event.text);
+            } else if (event.type == EventType::Clear) {
+                out << "\n--------\n";
+            }
+        }
+        out << "\n";
+    }
+    out.flush();
+}
+
+// Time as the player's clock ran, e.g. 3:58.2
+static string clock(uint64_t ms) {
+    char text[32];
+    snprintf(text, sizeof(text), "%llu:%02llu.%llu", (unsigned long long)(ms / 60000),
+             (unsigned long long)(ms / 1000 % 60), (unsigned long long)(ms / 100 % 10));
+    return text;
+}
+
+// Play input 'turn' with text on, so its screen can be shown
+static bool playShown(ReplayPlayer& player, long turn) {
+    if (!player.seek(turn - 1)) return false;
+    player.game().setText(true);
+    bool played = player.step();
+    player.game().setText(false);
+    return played;
+}
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Every input from the start, without checkpoints; returns the seconds taken
+static double playAll(ReplayPlayer& player) {
+    player.seek(0);
+    auto start = chrono::steady_clock::now();
+    while (player.step()) {
+    }
+    return secondsSince(start);
+}
+
+static void summary(ReplayPlayer& player, size_t fileBytes, bool json) {
+    long turns = player.turns();
+    printf("seed %llu, %ld inputs over %s, %zu checkpoints\n", (unsigned long long)player.seed(), turns,
+           clock(player.durationMs()).c_str(), player.checkpoints());
+    printf("%zu bytes, %.1f per input\n", fileBytes, turns ? (double)fileBytes / turns : 0.0);
+
+    double seconds = playAll(player);
+    printf("played in %.3f ms (%.2f us per input)\n", seconds * 1e3, turns ? seconds * 1e6 / turns : 0.0);
+
+    const char* status[] = { "still running", "lost", "won", "disconnected" };  // By GameStatus
+    printf("\ngame %s after input %ld\n", status[(int)player.result().status], turns);
+    printf("\nlast inputs:\n");
+    for (long turn = max(1L, turns - 9); turn <= turns; turn++) {
+        player.seek(turn);
+        printf("  %5ld  %8s  \"%.*s\"\n", turn, clock(player.timeMs()).c_str(), (int)player.input().size(),
+               player.input().data());
+    }
+    if (turns > 0 && playShown(player, turns)) {
+        printf("\nscreen after input %ld:\n", turns);
+        fflush(stdout);
+        printScreen(player.result(), json);
+    }
+}
+
+static void bench(ReplayPlayer& player) {
+    long turns = player.turns();
+    double full = playAll(player);
+
+    // Seeks in a scattered order, so most have to restore a checkpoint
+    long worst = 0;
+    long steps = 0;
+    auto start = chrono::steady_clock::now();
+    for (long i = 0; i <= turns; i++) {
+        long played = 0;
+        player.seek(i * 7919 % (turns + 1), &played);
+        worst = max(worst, played);
+        steps += played;
+    }
+    double seeks = secondsSince(start);
+    printf("full playback: %ld inputs in %.3f ms (%.2f us per input)\n", turns, full * 1e3,
+           turns ? full * 1e6 / turns : 0.0);
+    printf("seek:          %.2f us mean over %ld turns, %.1f inputs played mean, %ld worst\n",
+           seeks * 1e6 / (turns + 1), turns + 1, (double)steps / (turns + 1), worst);
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    long turn = -1;
+    bool json = false;
+    bool timing = false;
+    bool usage = false;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--turn=", 0) == 0) turn = atol(arg.c_str() + 7);
+        else if (arg == "--json") json = true;
+        else if (arg == "--bench") timing = true;
+        else if (!path && arg.rfind("--", 0) != 0) path = argv[i];
+        else usage = true;
+    }
+    if (!path || usage) {
+        fprintf(stderr, "usage: %s FILE [--turn=N] [--json] [--bench]\n", argv[0]);
+        return 2;
+    }
+
+    ifstream file(path, ios::binary);
+    stringstream contents;
+    contents << file.rdbuf();
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    string bytes = contents.str();
+    size_t fileBytes = bytes.size();
+    ReplayPlayer player(move(bytes));
+    if (!player.ok()) {
+        fprintf(stderr, "%s: not a replay file\n", path);
+        return 1;
+    }
+
+    if (timing) {
+        bench(player);
+    } else if (turn >= 0) {
+        if (turn > player.turns()) {
+            fprintf(stderr, "%s: only %ld inputs recorded\n", path, player.turns());
+            return 1;
+        }
+        if (turn > 0 && playShown(player, turn)) {
+            printf("input %ld at %s: \"%.*s\"\n", turn, clock(player.timeMs()).c_str(), (int)player.input().size(),
+                   player.input().data());
+        } else {
+            player.seek(0);
+        }
+        fflush(stdout);
+        printScreen(player.result(), json);
+        printf("\nstate after input %ld:\n%s", turn, player.game().save().c_str());
+    } else {
+        summary(player, fileBytes, json);
+    }
+    return 0;
+}
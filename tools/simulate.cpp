@@ -0,0 +1,384 @@
+// Monte Carlo playtest simulator: plays many headless games on every core
+// and reports how they end. Each game has its own seed (the run's base seed
+// plus the game number), so results don't depend on the thread count. Each
+// thread keeps its own statistics and they are merged at the end.
+//
+// Games run without display text, intro or undo, so a turn costs what the
+// engine's state changes cost. Two policies drive them:
+//
+//     random  picks any command from a vocabulary of real and plausible
+//             player input, and any answer at a prompt
+//     hint    follows the 'hint' planner, with a random command instead
+//             with probability --epsilon
+//
+// The report covers win and death rates by cause, turns to win, the 50%
+// dark-room pickup rolls in search() and feelAround(), how much oxygen was
+// left when the suit was sealed, and the commands most often not understood.
+//
+// Usage: ./simulate [--games=n] [--policy=hint|random] [--epsilon=p]
+//                   [--oxygen=n] [--max-turns=n] [--threads=n] [--seed=n]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <thread>
+
+#include "../game.h"
+
+struct Options {
+    long long games = 100000;
+    bool followHints = true;
+    double epsilon = 0.25;
+    int oxygen = EngineConfig().oxygenCommands;
+    int maxTurns = 1000;
+    int threads = 0;  // One per core
+    uint64_t seed = 1;
+};
+
+// Policy randomness, separate from the game's own so the policy can't
+// shift the game's rolls
+class PolicyRandom {
+    public:
+        explicit PolicyRandom(uint64_t seed) {
+            state.seed(seed ^ 0x5DEECE66DULL);
+        }
+
+        int below(int bound) {
+            return state.random(bound);
+        }
+
+        bool chance(double p) {
+            return state.random(1 << 20) < p * (1 << 20);
+        }
+
+    private:
+        GameState state;  // Only its generator is used
+};
+
+// Commands a wandering player might type: the real ones, item names that
+// exist and don't, and phrasings the parser may not know
+static const char* const RANDOM_COMMANDS[] = {
+    "search", "search room", "look around", "feel around", "move", "I", "i",
+    "m", "help", "hint", "use", "take", "drop", "examine",
+    "use headlight", "use glow stick", "use crowbar", "use duct tape",
+    "use blow torch", "use energy bar", "use radio", "use butane torch",
+    "take crowbar", "take duct tape", "take glow stick", "take sticky note",
+    "take blow torch", "take circuit board", "take butane canister",
+    "take energy bar", "take radio", "take pressure gauge",
+    "drop crowbar", "drop duct tape", "drop headlight",
+    "examine sticky note", "examine ascii table", "access computer",
+    "look", "go north", "open airlock", "read note", "eat energy bar",
+    "fix computer", "enter code", "repair suit", "turn on headlight",
+    "light", "quit", "climb", "open door", "go",
+};
+
+// Answers for an open prompt: menu numbers, codes and Enter
+static const char* const RANDOM_ANSWERS[] = {
+    "0", "1", "2", "3", "9572", "1234", "70 61 73 73 77 6F 72 64", "",
+};
+
+// What the hint policy types for each planner step (indexed by HintStep).
+// Entries after the first answer the prompts the command opens.
+static const char* const STEP_COMMANDS[] = {
+    "use duct tape",
+    "use headlight",
+    "use glow stick",
+    "search",
+    "take crowbar",
+    "take duct tape",
+    "take glow stick",
+    "take sticky note",
+    "take blow torch",
+    "take circuit board",
+    "take butane canister",
+    "use crowbar",
+    "move",
+    "move;2",
+    "move;2;9572",
+    "move;2",
+    "move;2;9572",
+    "use blow torch",
+    "move;2",
+    "move;1",
+    "move;1",
+    "move;1",
+    "move;1",
+    "access computer;70 61 73 73 77 6F 72 64;",
+};
+static_assert(sizeof(STEP_COMMANDS) / sizeof(STEP_COMMANDS[0]) == (size_t)HintStep::Count, "STEP_COMMANDS must match HintStep");
+
+struct Stats {
+    static const int TURN_BUCKETS = 16;   // Bucket i holds turn counts in [2^i, 2^(i+1))
+    static const int STREAK_BUCKETS = 10; // The last bucket holds longer streaks
+
+    long long games = 0;
+    long long won = 0;
+    long long unfinished = 0;             // Hit the turn limit
+    long long deaths[4] = {};             // By DeathCause
+    long long turnsToWin = 0;
+    long long fewestTurnsToWin = 0;
+    long long mostTurnsToWin = 0;
+    long long winTurns[TURN_BUCKETS] = {};
+    long long rolls[2] = {};              // Dark-room pickup rolls: search, feel around
+    long long finds[2] = {};
+    long long dryStreaks[STREAK_BUCKETS] = {};  // Misses before each find
+    long long unansweredMisses = 0;       // Misses the game ended before a find made up for
+    vector<long long> oxygenLeft;         // Commands to spare when the suit was sealed
+    map<string, long long> unknown;
+
+    void addWin(int turns) {
+        if (won == 0 || turns < fewestTurnsToWin) fewestTurnsToWin = turns;
+        if (turns > mostTurnsToWin) mostTurnsToWin = turns;
+        won++;
+        turnsToWin += turns;
+        int bucket = 0;
+        while (bucket < TURN_BUCKETS - 1 && (2 << bucket) <= turns) bucket++;
+        winTurns[bucket]++;
+    }
+
+    void merge(const Stats& other) {
+        if (other.won && (won == 0 || other.fewestTurnsToWin < fewestTurnsToWin)) fewestTurnsToWin = other.fewestTurnsToWin;
+        mostTurnsToWin = max(mostTurnsToWin, other.mostTurnsToWin);
+        games += other.games;
+        won += other.won;
+        unfinished += other.unfinished;
+        turnsToWin += other.turnsToWin;
+        for (int i = 0; i < 4; i++) deaths[i] += other.deaths[i];
+        for (int i = 0; i < TURN_BUCKETS; i++) winTurns[i] += other.winTurns[i];
+        for (int i = 0; i < 2; i++) {
+            rolls[i] += other.rolls[i];
+            finds[i] += other.finds[i];
+        }
+        for (int i = 0; i < STREAK_BUCKETS; i++) dryStreaks[i] += other.dryStreaks[i];
+        unansweredMisses += other.unansweredMisses;
+        if (oxygenLeft.size() < other.oxygenLeft.size()) oxygenLeft.resize(other.oxygenLeft.size());
+        for (size_t i = 0; i < other.oxygenLeft.size(); i++) oxygenLeft[i] += other.oxygenLeft[i];
+        for (const auto& entry : other.unknown) unknown[entry.first] += entry.second;
+    }
+};
+
+// One game from start to finish (or the turn limit)
+class Playtest {
+    public:
+        Playtest(uint64_t seed, const Options& options, Stats& stats, TurnArena& parserArena)
+            : game(seed, config(options)), policy(seed), options(options), stats(stats), parserArena(parserArena) {
+        }
+
+        void run() {
+            while (game.status == GameStatus::Running && turns < options.maxTurns) {
+                if (game.prompt == Prompt::Command) {
+                    planned = string_view();  // The step went differently; replan
+                }
+                string_view input;
+                if (!Game::nextBatchItem(planned, input)) {
+                    input = chooseInput();
+                }
+                play(input);
+            }
+            stats.games++;
+            stats.unansweredMisses += dryStreak;
+            if (game.status == GameStatus::Won) stats.addWin(turns);
+            else if (game.status == GameStatus::Died) stats.deaths[(int)game.deathCause]++;
+            else stats.unfinished++;
+        }
+
+    private:
+        static EngineConfig config(const Options& options) {
+            EngineConfig config;
+            config.showIntro = false;
+            config.text = false;
+            config.undoDepth = 0;
+            config.oxygenCommands = options.oxygen;
+            return config;
+        }
+
+        // The next input when no planned batch is under way
+        string_view chooseInput() {
+            if (game.prompt != Prompt::Command) {
+                if (options.followHints) return "0";  // Back out of menus the random moves opened
+                return RANDOM_ANSWERS[policy.below(sizeof(RANDOM_ANSWERS) / sizeof(RANDOM_ANSWERS[0]))];
+            }
+            if (options.followHints && !policy.chance(options.epsilon)) {
+                HintStep step;
+                int commands;
+                if (planHint(game.hintState(), step, commands)) {
+                    bool taking = step >= HintStep::TakeCrowbar && step <= HintStep::TakeButane;
+                    if (taking && game.inventory.size() >= Game::MAX_INVENTORY) {
+                        string_view spare = game.spareItem(commands);
+                        if (!spare.empty()) {
+                            dropCommand = "drop ";
+                            dropCommand.append(spare.data(), spare.size());
+                            return dropCommand;
+                        }
+                    }
+                    planned = STEP_COMMANDS[(int)step];
+                    string_view first;
+                    Game::nextBatchItem(planned, first);
+                    return first;
+                }
+            }
+            return RANDOM_COMMANDS[policy.below(sizeof(RANDOM_COMMANDS) / sizeof(RANDOM_COMMANDS[0]))];
+        }
+
+        void play(string_view input) {
+            Verb verb = Verb::Unknown;
+            bool command = game.prompt == Prompt::Command;
+            if (command) {
+                Action action = parseAction(input, parserArena);
+                verb = action.verb;
+                if (verb == Verb::Unknown) stats.unknown[string(action.text)]++;
+                parserArena.reset();
+            }
+
+            uint64_t rngBefore = game.rngState;
+            bool sealedBefore = game.suitRepaired;
+            game.parseCommand(input);
+            game.out.clear();
+            turns++;
+
+            // The game's generator only moves for the dark-room pickup, and
+            // its first draw is the 50% roll; replay it to see how it fell
+            if (command && game.rngState != rngBefore && (verb == Verb::Search || verb == Verb::Feel)) {
+                GameState replay;
+                replay.rngState = rngBefore;
+                bool found = replay.random(2) == 0;
+                int source = verb == Verb::Search ? 0 : 1;
+                stats.rolls[source]++;
+                if (found) {
+                    stats.finds[source]++;
+                    stats.dryStreaks[min(dryStreak, Stats::STREAK_BUCKETS - 1)]++;
+                    dryStreak = 0;
+                } else {
+                    dryStreak++;
+                }
+            }
+            if (!sealedBefore && game.suitRepaired) {
+                size_t left = max(game.commandsUntilDeath, 0);
+                if (stats.oxygenLeft.size() <= left) stats.oxygenLeft.resize(left + 1);
+                stats.oxygenLeft[left]++;
+            }
+        }
+
+        Game game;
+        PolicyRandom policy;
+        const Options& options;
+        Stats& stats;
+        TurnArena& parserArena;
+        string_view planned;  // Rest of a multi-entry step
+        string dropCommand;
+        int turns = 0;
+        int dryStreak = 0;
+};
+
+static void worker(const Options& options, atomic<long long>& nextGame, Stats& stats) {
+    const long long CHUNK = 64;
+    TurnArena parserArena;
+    while (true) {
+        long long first = nextGame.fetch_add(CHUNK);
+        if (first >= options.games) break;
+        long long last = min(first + CHUNK, options.games);
+        for (long long i = first; i < last; i++) {
+            Playtest(options.seed + i, options, stats, parserArena).run();
+        }
+    }
+}
+
+static double percent(long long part, long long whole) {
+    return whole ? 100.0 * part / whole : 0;
+}
+
+static void report(const Stats& stats, const Options& options, int threads, double seconds) {
+    printf("Games: %lld (policy %s", stats.games, options.followHints ? "hint" : "random");
+    if (options.followHints) printf(", epsilon %.2f", options.epsilon);
+    printf(", oxygen %d) on %d threads in %.2f s (%.0f games/s)\n\n",
+           options.oxygen, threads, seconds, seconds > 0 ? stats.games / seconds : 0);
+
+    printf("%-28s %6.2f%%", "Won", percent(stats.won, stats.games));
+    if (stats.won) {
+        printf("  mean %.1f turns (min %lld, max %lld)", (double)stats.turnsToWin / stats.won,
+               stats.fewestTurnsToWin, stats.mostTurnsToWin);
+    }
+    printf("\n");
+    for (int cause = 1; cause < 4; cause++) {
+        string label = string("Died: ") + deathCauseName((DeathCause)cause);
+        printf("%-28s %6.2f%%\n", label.c_str(), percent(stats.deaths[cause], stats.games));
+    }
+    string limit = "Hit the turn limit (" + to_string(options.maxTurns) + ")";
+    printf("%-28s %6.2f%%\n", limit.c_str(), percent(stats.unfinished, stats.games));
+
+    if (stats.won) {
+        printf("\nTurns to win:\n");
+        for (int i = 0; i < Stats::TURN_BUCKETS; i++) {
+            if (stats.winTurns[i] == 0) continue;
+            printf("    [%d, %d)  %lld\n", 1 << i, 2 << i, stats.winTurns[i]);
+        }
+    }
+
+    printf("\nDark-room pickup rolls (50%% each):\n");
+    const char* const SOURCES[] = { "search", "feel around" };
+    for (int i = 0; i < 2; i++) {
+        printf("    %-12s %lld rolls, %.2f%% found\n", SOURCES[i], stats.rolls[i], percent(stats.finds[i], stats.rolls[i]));
+    }
+    printf("Misses before each find:\n");
+    for (int i = 0; i < Stats::STREAK_BUCKETS; i++) {
+        printf("    %d%s  %lld\n", i, i == Stats::STREAK_BUCKETS - 1 ? "+" : "", stats.dryStreaks[i]);
+    }
+    printf("Misses at the end of a game with no find after them: %lld\n", stats.unansweredMisses);
+
+    long long sealed = 0;
+    for (long long count : stats.oxygenLeft) sealed += count;
+    printf("\nOxygen commands left when the suit was sealed (%lld games):\n", sealed);
+    for (size_t i = 0; i < stats.oxygenLeft.size(); i++) {
+        if (stats.oxygenLeft[i]) printf("    %2zu  %lld\n", i, stats.oxygenLeft[i]);
+    }
+
+    vector<pair<long long, string>> unknown;
+    for (const auto& entry : stats.unknown) unknown.push_back({entry.second, entry.first});
+    sort(unknown.rbegin(), unknown.rend());
+    printf("\nMost common unknown commands:\n");
+    for (size_t i = 0; i < unknown.size() && i < 10; i++) {
+        printf("    %8lld  %s\n", unknown[i].first, unknown[i].second.c_str());
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--games=", 0) == 0) options.games = atoll(arg.c_str() + 8);
+        else if (arg == "--policy=hint") options.followHints = true;
+        else if (arg == "--policy=random") options.followHints = false;
+        else if (arg.rfind("--epsilon=", 0) == 0) options.epsilon = atof(arg.c_str() + 10);
+        else if (arg.rfind("--oxygen=", 0) == 0) options.oxygen = atoi(arg.c_str() + 9);
+        else if (arg.rfind("--max-turns=", 0) == 0) options.maxTurns = atoi(arg.c_str() + 12);
+        else if (arg.rfind("--threads=", 0) == 0) options.threads = atoi(arg.c_str() + 10);
+        else if (arg.rfind("--seed=", 0) == 0) options.seed = strtoull(arg.c_str() + 7, NULL, 10);
+        else {
+            fprintf(stderr, "usage: %s [--games=n] [--policy=hint|random] [--epsilon=p] [--oxygen=n]\n"
+                            "       [--max-turns=n] [--threads=n] [--seed=n]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (options.games < 0 || options.maxTurns <= 0 || options.oxygen <= 0) {
+        fprintf(stderr, "%s: games, turn limit and oxygen must be positive\n", argv[0]);
+        return 2;
+    }
+    int threads = options.threads > 0 ? options.threads : max(1u, thread::hardware_concurrency());
+
+    auto start = chrono::steady_clock::now();
+    atomic<long long> nextGame(0);
+    vector<Stats> perThread(threads);
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++) {
+        pool.emplace_back(worker, cref(options), ref(nextGame), ref(perThread[i]));
+    }
+    Stats total;
+    for (int i = 0; i < threads; i++) {
+        pool[i].join();
+        total.merge(perThread[i]);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    report(total, options, threads, seconds);
+    return 0;
+}
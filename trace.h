@@ -0,0 +1,185 @@
+// Timeline tracing for the engine and its front ends. A TraceScope marks
+// one phase (a handler, wrapText, a flush); when it ends it records a
+// complete event into a ring buffer owned by the calling thread.
+// writeChromeTrace() (station.h) dumps every thread's buffer as Chrome trace
+// JSON, which chrome://tracing and Perfetto open as a timeline.
+//
+// Tracing is off until setTracing(true). A disabled trace point costs one
+// relaxed load; an enabled one reads the clock twice and stores three words.
+// The same trace points also feed a CommandProfile, the per-phase totals
+// the slow-command log (slowlog.h) reports, while one is active on the thread.
+#ifndef STATION_TRACE_H
+#define STATION_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+
+// Slots are atomics because a dump may read a buffer while its thread is
+// still writing; the one slot being overwritten at that moment can come out
+// mixed, which a timeline can live with.
+struct TraceEvent {
+    std::atomic<const char*> name;   // Static text
+    std::atomic<uint64_t> start;     // Nanoseconds on the steady clock
+    std::atomic<uint64_t> duration;
+};
+
+// The newest CAPACITY events of one thread
+class TraceBuffer {
+    public:
+        static const size_t CAPACITY = 1 << 16;
+
+        explicit TraceBuffer(int thread) : thread(thread), events(new TraceEvent[CAPACITY]) {
+        }
+
+        void record(const char* name, uint64_t start, uint64_t duration) {
+            uint64_t index = head.load(std::memory_order_relaxed);
+            TraceEvent& event = events[index % CAPACITY];
+            event.name.store(name, std::memory_order_relaxed);
+            event.start.store(start, std::memory_order_relaxed);
+            event.duration.store(duration, std::memory_order_relaxed);
+            head.store(index + 1, std::memory_order_release);
+        }
+
+        // Call with the event count read from head, oldest first
+        template <typename Visitor>
+        void visit(uint64_t end, Visitor&& visitor) const {
+            uint64_t begin = end > CAPACITY ? end - CAPACITY : 0;
+            for (uint64_t i = begin; i < end; i++) {
+                const TraceEvent& event = events[i % CAPACITY];
+                visitor(event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed),
+                        event.duration.load(std::memory_order_relaxed));
+            }
+        }
+
+        const int thread;                  // Small number shown as the trace's tid
+        std::atomic<uint64_t> head{0};     // Events ever recorded
+
+    private:
+        std::unique_ptr<TraceEvent[]> events;
+};
+
+// Every thread's buffer; buffers outlive their threads so a dump can still
+// show what a finished worker did
+struct TraceRegistry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+};
+
+inline TraceRegistry& traceRegistry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+inline std::atomic<bool> traceEnabled{false};
+
+inline void setTracing(bool enabled) {
+    traceEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+inline bool tracing() {
+    return traceEnabled.load(std::memory_order_relaxed);
+}
+
+inline uint64_t traceClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The calling thread's buffer, made on its first traced event
+inline TraceBuffer& traceBuffer() {
+    thread_local TraceBuffer* buffer = NULL;
+    if (!buffer) {
+        TraceRegistry& registry = traceRegistry();
+        std::lock_guard<std::mutex> hold(registry.lock);
+        registry.buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer(registry.buffers.size() + 1)));
+        buffer = registry.buffers.back().get();
+    }
+    return *buffer;
+}
+
+// Time spent under one trace name, summed over its calls
+struct PhaseTime {
+    const char* name;
+    uint64_t duration;  // Nanoseconds
+    int calls;
+};
+
+// Per-phase totals for one step, in the order the phases were first entered.
+// Nested phases count in their parents' time too.
+class CommandProfile {
+    public:
+        static const int MAX_PHASES = 24;  // Later names go uncounted
+
+        // The slot for a name, added on first use; NULL when full
+        PhaseTime* enter(const char* name) {
+            for (int i = 0; i < count; i++) {
+                if (phases[i].name == name || strcmp(phases[i].name, name) == 0) return &phases[i];
+            }
+            if (count == MAX_PHASES) return NULL;
+            phases[count] = { name, 0, 0 };
+            return &phases[count++];
+        }
+
+        const PhaseTime* begin() const { return phases; }
+        const PhaseTime* end() const { return phases + count; }
+
+    private:
+        PhaseTime phases[MAX_PHASES];
+        int count = 0;
+};
+
+// The profile trace points on this thread add to, if any
+inline thread_local CommandProfile* activeProfile = NULL;
+
+// Makes a profile active for its lifetime
+class ProfileScope {
+    public:
+        explicit ProfileScope(CommandProfile& profile) : previous(activeProfile) {
+            activeProfile = &profile;
+        }
+
+        ~ProfileScope() {
+            activeProfile = previous;
+        }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+        CommandProfile* previous;
+};
+
+// Records the time from construction to destruction under a static name
+class TraceScope {
+    public:
+        explicit TraceScope(const char* name)
+            : name(name), phase(activeProfile ? activeProfile->enter(name) : NULL), traced(tracing()),
+              start(traced || phase ? traceClock() : 0) {
+        }
+
+        ~TraceScope() {
+            if (!start) return;
+            uint64_t duration = traceClock() - start;
+            if (traced) traceBuffer().record(name, start, duration);
+            if (phase) {
+                phase->duration += duration;
+                phase->calls++;
+            }
+        }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        const char* name;
+        PhaseTime* phase;  // In the profile active at the start
+        bool traced;       // Tracing was on at the start
+        uint64_t start;    // 0 when neither wants the time
+};
+
+#endif
@@ -0,0 +1,247 @@
+// A small io_uring ring over the raw system calls, for the session server's
+// io_uring backend (StationServer.cpp); no liburing needed. It covers what
+// the server uses: one submission and one completion queue, a wait with a
+// timeout that also submits, and one group of provided buffers for
+// receives. Needs Linux 5.19 or later.
+#ifndef STATION_URING_H
+#define STATION_URING_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+class IoUring {
+    public:
+        // A ring with room for 'entries' submissions and four times as many
+        // completions; error() says whether it was set up
+        explicit IoUring(unsigned entries) {
+            io_uring_params params = {};
+            params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+            params.cq_entries = entries * 4;
+            fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+            if (fd < 0 && errno == EINVAL) {
+                params = {};  // Before 5.19: no cooperative task running
+                params.flags = IORING_SETUP_CQSIZE;
+                params.cq_entries = entries * 4;
+                fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+            }
+            if (fd < 0) {
+                setupError = errno;
+                return;
+            }
+            if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+                setupError = ENOSYS;
+                return;
+            }
+
+            ringBytes = max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+            ring = mmap(NULL, ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqeMemory = mmap(NULL, sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (ring == MAP_FAILED || sqeMemory == MAP_FAILED) {
+                setupError = errno;
+                return;
+            }
+            char* base = (char*)ring;
+            sqHead = (unsigned*)(base + params.sq_off.head);
+            sqTail = (unsigned*)(base + params.sq_off.tail);
+            sqMask = *(unsigned*)(base + params.sq_off.ring_mask);
+            sqEntries = params.sq_entries;
+            sqArray = (unsigned*)(base + params.sq_off.array);
+            sqes = (io_uring_sqe*)sqeMemory;
+            cqHead = (unsigned*)(base + params.cq_off.head);
+            cqTail = (unsigned*)(base + params.cq_off.tail);
+            cqMask = *(unsigned*)(base + params.cq_off.ring_mask);
+            cqes = (io_uring_cqe*)(base + params.cq_off.cqes);
+            localTail = *sqTail;
+            setupError = 0;
+        }
+
+        ~IoUring() {
+            if (buffers) munmap(buffers, bufferRingBytes);
+            if (sqes) munmap(sqes, sqeBytes);
+            if (ring && ring != MAP_FAILED) munmap(ring, ringBytes);
+            if (fd >= 0) close(fd);
+        }
+
+        IoUring(const IoUring&) = delete;
+        IoUring& operator=(const IoUring&) = delete;
+
+        int error() const {
+            return setupError;
+        }
+
+        // A cleared submission entry, queued for the next submit. Submits
+        // what is queued first if the queue is full.
+        io_uring_sqe* next() {
+            if (localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) == sqEntries) {
+                enter(0, 0, -1);
+            }
+            unsigned index = localTail & sqMask;
+            io_uring_sqe* sqe = &sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqArray[index] = index;
+            localTail++;
+            return sqe;
+        }
+
+        // Submit what is queued and wait until a completion arrives or the
+        // timeout passes; one system call. Returns a negative errno on error.
+        int submitAndWait(int timeoutMs) {
+            return enter(1, IORING_ENTER_GETEVENTS, timeoutMs);
+        }
+
+        // Call visit(cqe) for each completion that has arrived, then give
+        // their slots back
+        template <class Visit>
+        void completions(Visit visit) {
+            unsigned head = *cqHead;
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++) {
+                visit(cqes[head & cqMask]);
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        }
+
+        // Provide 'count' (a power of two) buffers of 'size' bytes as
+        // buffer group 'group'. A receive with IOSQE_BUFFER_SELECT picks
+        // one when data arrives, so idle connections hold none. Buffers go
+        // in a registered ring that recycling writes to directly; kernels
+        // that take the ring but don't select from it get the buffers
+        // through IORING_OP_PROVIDE_BUFFERS instead. Returns 0 or a
+        // negative errno.
+        int provideBuffers(unsigned count, unsigned size, uint16_t group) {
+            bufferMask = count - 1;
+            bufferSize = size;
+            bufferGroup = group;
+            bufferMemory.resize((size_t)count * size);
+            bufferRingBytes = count * sizeof(io_uring_buf);
+            void* memory = mmap(NULL, bufferRingBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) return -errno;
+            buffers = (io_uring_buf_ring*)memory;
+            io_uring_buf_reg registration = {};
+            registration.ring_addr = (uint64_t)buffers;
+            registration.ring_entries = count;
+            registration.bgid = group;
+            if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &registration, 1) == 0) {
+                for (unsigned id = 0; id < count; id++) {
+                    recycle((uint16_t)id);
+                }
+                if (ringSelects()) return 0;
+                syscall(__NR_io_uring_register, fd, IORING_UNREGISTER_PBUF_RING, &registration, 1);
+            }
+            munmap(buffers, bufferRingBytes);
+            buffers = NULL;
+
+            io_uring_sqe* sqe = next();
+            sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+            sqe->fd = count;
+            sqe->addr = (uint64_t)bufferMemory.data();
+            sqe->len = size;
+            sqe->buf_group = group;
+            int result = 0;
+            enter(1, IORING_ENTER_GETEVENTS, 1000);
+            completions([&](const io_uring_cqe& cqe) { result = cqe.res < 0 ? cqe.res : 0; });
+            return result;
+        }
+
+        // The data of the buffer a completion picked
+        char* buffer(uint16_t id) {
+            return bufferMemory.data() + (size_t)id * bufferSize;
+        }
+
+        // Hand a picked buffer back for the next receive. Without a ring this
+        // queues a submission whose completion has user_data 0.
+        void recycle(uint16_t id) {
+            if (!buffers) {
+                io_uring_sqe* sqe = next();
+                sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+                sqe->fd = 1;
+                sqe->addr = (uint64_t)buffer(id);
+                sqe->len = bufferSize;
+                sqe->off = id;
+                sqe->buf_group = bufferGroup;
+                return;
+            }
+            io_uring_buf& entry = buffers->bufs[bufferTail & bufferMask];
+            entry.addr = (uint64_t)buffer(id);
+            entry.len = bufferSize;
+            entry.bid = id;
+            bufferTail++;
+            __atomic_store_n(&buffers->tail, bufferTail, __ATOMIC_RELEASE);
+        }
+
+    private:
+        int fd = -1;
+        int setupError = ENOSYS;
+        void* ring = NULL;
+        size_t ringBytes = 0;
+        io_uring_sqe* sqes = NULL;
+        size_t sqeBytes = 0;
+        unsigned* sqHead;
+        unsigned* sqTail;
+        unsigned* sqArray;
+        unsigned sqMask;
+        unsigned sqEntries;
+        unsigned localTail;   // Entries queued but not yet published
+        unsigned* cqHead;
+        unsigned* cqTail;
+        unsigned cqMask;
+        io_uring_cqe* cqes;
+        io_uring_buf_ring* buffers = NULL;
+        size_t bufferRingBytes = 0;
+        unsigned bufferMask = 0;
+        unsigned bufferSize = 0;
+        uint16_t bufferGroup = 0;
+        uint16_t bufferTail = 0;
+        vector<char> bufferMemory;
+
+        // Whether a receive takes a buffer from the ring just registered:
+        // one byte through a socket pair
+        bool ringSelects() {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) return false;
+            bool selected = false;
+            if (::write(pair[1], "", 1) == 1) {
+                io_uring_sqe* sqe = next();
+                sqe->opcode = IORING_OP_RECV;
+                sqe->fd = pair[0];
+                sqe->len = bufferSize;
+                sqe->flags = IOSQE_BUFFER_SELECT;
+                sqe->buf_group = bufferGroup;
+                enter(1, IORING_ENTER_GETEVENTS, 1000);
+                completions([&](const io_uring_cqe& cqe) {
+                    if (cqe.res == 1 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                        selected = true;
+                        recycle(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                    }
+                });
+            }
+            close(pair[0]);
+            close(pair[1]);
+            return selected;
+        }
+
+        int enter(unsigned waitFor, unsigned flags, int timeoutMs) {
+            __atomic_store_n(sqTail, localTail, __ATOMIC_RELEASE);
+            unsigned toSubmit = localTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+            __kernel_timespec timeout = { timeoutMs / 1000, (long long)(timeoutMs % 1000) * 1000000 };
+            io_uring_getevents_arg arg = {};
+            arg.ts = timeoutMs >= 0 ? (uint64_t)&timeout : 0;
+            long result = syscall(__NR_io_uring_enter, fd, toSubmit, waitFor, flags | IORING_ENTER_EXT_ARG, &arg,
+                                  sizeof(arg));
+            return result < 0 ? -errno : (int)result;
+        }
+};
+
+#endif